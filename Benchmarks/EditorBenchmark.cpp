@@ -0,0 +1,183 @@
+/*
+  ==============================================================================
+
+    Times the editor's rendering into an offscreen image at 1x, 1.5x and 2x,
+    the scales a host's display can ask for, and writes the results as JSON.
+
+    At each scale, a new editor is made and painted whole: once with nothing
+    decoded yet, then --paints more times. Then the mix knob is dragged across
+    all 91 of its frames, repainting only the knob each time, as a drag does,
+    and back again. Each knob only keeps its last few scaled frames, so the
+    start of the way back is a plain copy and the rest is decoded again.
+
+    Usage: YetiEditorBench [--paints N] [--output FILE]
+
+  ==============================================================================
+*/
+
+#include <JuceHeader.h>
+#include "PluginProcessor.h"
+#include "PluginEditor.h"
+
+namespace
+{
+    struct Options
+    {
+        int paints = 50;
+        juce::File output;          // stdout if not set
+    };
+
+    struct Times
+    {
+        std::vector<double> milliseconds;
+
+        juce::var toJson() const
+        {
+            auto sorted = milliseconds;
+            std::sort(sorted.begin(), sorted.end());
+
+            auto* object = new juce::DynamicObject();
+            object->setProperty("count", (int) sorted.size());
+            object->setProperty("meanMs", std::accumulate(sorted.begin(), sorted.end(), 0.0) / (double) juce::jmax<size_t>(1, sorted.size()));
+            object->setProperty("medianMs", sorted.empty() ? 0.0 : sorted[sorted.size() / 2]);
+            object->setProperty("minMs", sorted.empty() ? 0.0 : sorted.front());
+            object->setProperty("maxMs", sorted.empty() ? 0.0 : sorted.back());
+            return object;
+        }
+    };
+
+    template <typename Paint>
+    double timePaint(Paint&& paint)
+    {
+        const auto start = juce::Time::getHighResolutionTicks();
+        paint();
+        return juce::Time::highResolutionTicksToSeconds(juce::Time::getHighResolutionTicks() - start) * 1000.0;
+    }
+
+    /** Paints the area of the editor into the image, as a repaint of that area
+        would be drawn on a display with the given scale.
+    */
+    void paintArea(juce::Component& editor, juce::Image& image, float scale, juce::Rectangle<int> area)
+    {
+        juce::Graphics g(image);
+        g.addTransform(juce::AffineTransform::scale(scale));
+        g.reduceClipRegion(area);
+        editor.paintEntireComponent(g, true);
+    }
+
+    juce::Slider* findKnob(juce::Component& editor)
+    {
+        for (auto* child : editor.getChildren())
+            if (auto* slider = dynamic_cast<juce::Slider*>(child); slider != nullptr && slider->isVisible())
+                return slider;
+
+        return nullptr;
+    }
+
+    juce::var measureScale(float scale, const Options& options)
+    {
+        // Nothing the last scale decoded is kept, so the first paint is cold.
+        juce::ImageCache::releaseUnusedImages();
+
+        YetiReverbAudioProcessor processor;
+        YetiReverbAudioProcessorEditor editor(processor);
+
+        juce::Image image(juce::Image::ARGB, juce::roundToInt((float) editor.getWidth() * scale),
+                          juce::roundToInt((float) editor.getHeight() * scale), true);
+        const auto bounds = editor.getLocalBounds();
+
+        const auto firstPaint = timePaint([&] { paintArea(editor, image, scale, bounds); });
+
+        Times paints;
+
+        for (int i = 0; i < options.paints; ++i)
+            paints.milliseconds.push_back(timePaint([&] { paintArea(editor, image, scale, bounds); }));
+
+        Times dragFrames, returnFrames;
+
+        if (auto* knob = findKnob(editor))
+        {
+            const auto drag = [&](Times& times, int frame)
+            {
+                knob->setValue(knob->proportionOfLengthToValue((double) frame / 90.0), juce::sendNotificationSync);
+                times.milliseconds.push_back(timePaint([&] { paintArea(editor, image, scale, knob->getBounds()); }));
+            };
+
+            for (int frame = 0; frame <= 90; ++frame)
+                drag(dragFrames, frame);
+
+            for (int frame = 90; frame >= 0; --frame)
+                drag(returnFrames, frame);
+        }
+
+        const auto mean = [](const Times& times)
+        {
+            return std::accumulate(times.milliseconds.begin(), times.milliseconds.end(), 0.0) / (double) juce::jmax<size_t>(1, times.milliseconds.size());
+        };
+
+        const auto dragTotal = std::accumulate(dragFrames.milliseconds.begin(), dragFrames.milliseconds.end(), 0.0);
+
+        std::fprintf(stderr, "%.1fx  first paint %8.2f ms  paint %7.2f ms  drag frame %7.2f ms (%6.2f ms back)  drag total %8.2f ms\n",
+                     scale, firstPaint, mean(paints), mean(dragFrames), mean(returnFrames), dragTotal);
+
+        auto* object = new juce::DynamicObject();
+        object->setProperty("scale", scale);
+        object->setProperty("width", image.getWidth());
+        object->setProperty("height", image.getHeight());
+        object->setProperty("firstPaintMs", firstPaint);
+        object->setProperty("paint", paints.toJson());
+        object->setProperty("dragFrame", dragFrames.toJson());
+        object->setProperty("dragTotalMs", dragTotal);
+        object->setProperty("returnFrame", returnFrames.toJson());
+        object->setProperty("imageMemory", (juce::int64) editor.getImageMemoryUsage());
+        return object;
+    }
+
+    Options parseOptions(const juce::StringArray& args)
+    {
+        Options options;
+
+        for (int i = 0; i < args.size(); ++i)
+        {
+            const auto& arg = args[i];
+            const auto next = [&] { return args[juce::jmin(++i, args.size() - 1)]; };
+
+            if (arg == "--paints")       options.paints = juce::jmax(1, next().getIntValue());
+            else if (arg == "--output")  options.output = juce::File::getCurrentWorkingDirectory().getChildFile(next());
+            else std::fprintf(stderr, "ignoring unknown argument %s\n", arg.toRawUTF8());
+        }
+
+        return options;
+    }
+}
+
+int main(int argc, char* argv[])
+{
+    juce::ScopedJuceInitialiser_GUI juceInitialiser;
+
+    juce::StringArray args;
+
+    for (int i = 1; i < argc; ++i)
+        args.add(argv[i]);
+
+    const auto options = parseOptions(args);
+
+    juce::Array<juce::var> results;
+
+    for (const auto scale : { 1.0f, 1.5f, 2.0f })
+        results.add(measureScale(scale, options));
+
+    auto* report = new juce::DynamicObject();
+    report->setProperty("benchmark", "YetiEditorBench");
+    report->setProperty("paints", options.paints);
+    report->setProperty("results", results);
+
+    const auto json = juce::JSON::toString(juce::var(report));
+
+    if (options.output == juce::File())
+        std::printf("%s\n", json.toRawUTF8());
+    else if (! options.output.replaceWithText(json))
+        return 1;
+
+    return 0;
+}
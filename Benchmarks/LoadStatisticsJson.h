@@ -0,0 +1,41 @@
+#pragma once
+
+#include <JuceHeader.h>
+#include "DspLoadMeter.h"
+
+//==============================================================================
+/** The distribution of block times, as shares of each block's deadline,
+    with the buckets that were used.
+*/
+inline juce::var toJson(const LoadStatistics& statistics)
+{
+    const auto percent = [](float load) { return std::isfinite(load) ? (double) load * 100.0 : -1.0; };
+
+    juce::Array<juce::var> histogram;
+
+    for (int bucket = 0; bucket < LoadStatistics::numBuckets; ++bucket)
+    {
+        if (statistics.buckets[(size_t) bucket] == 0)
+            continue;
+
+        // The last bucket has no upper edge, so it's given as -1.
+        auto* entry = new juce::DynamicObject();
+        entry->setProperty("upToPercent", percent(LoadStatistics::getBucketUpperEdge(bucket)));
+        entry->setProperty("blocks", (juce::int64) statistics.buckets[(size_t) bucket]);
+        histogram.add(entry);
+    }
+
+    auto* object = new juce::DynamicObject();
+    object->setProperty("blocks", (juce::int64) statistics.numBlocks);
+    object->setProperty("meanPercent", percent(statistics.getMean()));
+    object->setProperty("jitterPercent", percent(statistics.getJitter()));
+    object->setProperty("p50Percent", percent(statistics.getPercentile(0.5)));
+    object->setProperty("p99Percent", percent(statistics.getPercentile(0.99)));
+    object->setProperty("p999Percent", percent(statistics.getPercentile(0.999)));
+    object->setProperty("worstPercent", percent(statistics.worst));
+    object->setProperty("blocksOver50Percent", (juce::int64) statistics.over50);
+    object->setProperty("blocksOver80Percent", (juce::int64) statistics.over80);
+    object->setProperty("blocksOverDeadline", (juce::int64) statistics.overDeadline);
+    object->setProperty("histogram", histogram);
+    return object;
+}
@@ -0,0 +1,237 @@
+#include "PerfCounters.h"
+
+#if JUCE_LINUX
+ #include <linux/perf_event.h>
+ #include <sys/ioctl.h>
+ #include <sys/syscall.h>
+ #include <unistd.h>
+ #include <cerrno>
+ #include <cstring>
+#endif
+
+namespace
+{
+   #if JUCE_LINUX
+    struct Reading
+    {
+        juce::uint64 value, enabled, running;
+    };
+
+    /** The type and config of the event, or false if this CPU has no way to
+        count it.
+    */
+    bool describe(PerfCounters::Event event, perf_event_attr& attr)
+    {
+        const auto cache = [](juce::uint64 level)
+        {
+            return level | ((juce::uint64) PERF_COUNT_HW_CACHE_OP_READ << 8)
+                         | ((juce::uint64) PERF_COUNT_HW_CACHE_RESULT_MISS << 16);
+        };
+
+        switch (event)
+        {
+            case PerfCounters::cycles:          attr.type = PERF_TYPE_HARDWARE; attr.config = PERF_COUNT_HW_CPU_CYCLES; return true;
+            case PerfCounters::instructions:    attr.type = PERF_TYPE_HARDWARE; attr.config = PERF_COUNT_HW_INSTRUCTIONS; return true;
+            case PerfCounters::l1dMisses:       attr.type = PERF_TYPE_HW_CACHE; attr.config = cache(PERF_COUNT_HW_CACHE_L1D); return true;
+            case PerfCounters::llcMisses:       attr.type = PERF_TYPE_HW_CACHE; attr.config = cache(PERF_COUNT_HW_CACHE_LL); return true;
+            case PerfCounters::branchMisses:    attr.type = PERF_TYPE_HARDWARE; attr.config = PERF_COUNT_HW_BRANCH_MISSES; return true;
+
+            case PerfCounters::l2Misses:
+            {
+                // L2_RQSTS.MISS on Intel since Skylake, and L2 misses from the
+                // L1 caches (l2_cache_req_stat.ic_dc_miss_in_l2) on AMD Zen.
+                const auto vendor = juce::SystemStats::getCpuVendor();
+                attr.type = PERF_TYPE_RAW;
+
+                if (vendor == "GenuineIntel")   { attr.config = 0x3f24; return true; }
+                if (vendor == "AuthenticAMD")   { attr.config = 0x0964; return true; }
+                return false;
+            }
+
+            case PerfCounters::numEvents:
+            default:
+                break;
+        }
+
+        return false;
+    }
+
+    int open(perf_event_attr& attr, int groupFd)
+    {
+        attr.size = sizeof(attr);
+        attr.disabled = groupFd < 0 ? 1u : 0u;  // the rest follow the leader
+        attr.exclude_kernel = 1;
+        attr.exclude_hv = 1;
+        attr.read_format = PERF_FORMAT_TOTAL_TIME_ENABLED | PERF_FORMAT_TOTAL_TIME_RUNNING;
+
+        return (int) syscall(SYS_perf_event_open, &attr, 0, -1, groupFd, 0);
+    }
+
+    bool readEvent(int fd, Reading& reading) noexcept
+    {
+        return fd >= 0 && ::read(fd, &reading, sizeof(reading)) == (ssize_t) sizeof(reading);
+    }
+   #endif
+}
+
+//==============================================================================
+PerfCounters::PerfCounters()
+{
+    fds.fill(-1);
+    leaders.fill(-1);
+
+   #if JUCE_LINUX
+    for (int event = 0; event < numEvents; ++event)
+    {
+        perf_event_attr attr;
+        std::memset(&attr, 0, sizeof(attr));
+
+        if (! describe((Event) event, attr))
+            continue;
+
+        auto& leader = leaders[(size_t) getGroup((Event) event)];
+        const auto fd = open(attr, leader);
+
+        if (fd < 0)
+        {
+            if (error.isEmpty())
+                error = juce::String(getName((Event) event)) + ": " + juce::String(std::strerror(errno));
+
+            continue;
+        }
+
+        fds[(size_t) event] = fd;
+
+        if (leader < 0)
+            leader = fd;
+    }
+
+    if (isAvailable())
+        error = {};
+   #else
+    error = "hardware counters are only read on Linux";
+   #endif
+}
+
+PerfCounters::~PerfCounters()
+{
+   #if JUCE_LINUX
+    for (const auto fd : fds)
+        if (fd >= 0)
+            close(fd);
+   #endif
+}
+
+bool PerfCounters::isAvailable() const noexcept
+{
+    return std::any_of(leaders.begin(), leaders.end(), [](int fd) { return fd >= 0; });
+}
+
+void PerfCounters::start() noexcept
+{
+   #if JUCE_LINUX
+    for (const auto leader : leaders)
+        if (leader >= 0)
+            ioctl(leader, PERF_EVENT_IOC_ENABLE, PERF_IOC_FLAG_GROUP);
+   #endif
+}
+
+void PerfCounters::stop() noexcept
+{
+   #if JUCE_LINUX
+    for (const auto leader : leaders)
+        if (leader >= 0)
+            ioctl(leader, PERF_EVENT_IOC_DISABLE, PERF_IOC_FLAG_GROUP);
+   #endif
+}
+
+void PerfCounters::reset() noexcept
+{
+   #if JUCE_LINUX
+    for (const auto leader : leaders)
+        if (leader >= 0)
+            ioctl(leader, PERF_EVENT_IOC_RESET, PERF_IOC_FLAG_GROUP);
+   #endif
+}
+
+PerfCounters::Counts PerfCounters::read() const noexcept
+{
+    Counts counts;
+
+   #if JUCE_LINUX
+    for (size_t event = 0; event < fds.size(); ++event)
+    {
+        Reading reading;
+
+        if (readEvent(fds[event], reading) && reading.running > 0)
+        {
+            counts.values[event] = (double) reading.value * (double) reading.enabled / (double) reading.running;
+            counts.counted[event] = true;
+            counts.multiplexed[event] = reading.running < reading.enabled;
+        }
+    }
+   #endif
+
+    return counts;
+}
+
+double PerfCounters::getCoverage() const noexcept
+{
+    auto coverage = 1.0;
+
+   #if JUCE_LINUX
+    for (const auto fd : fds)
+    {
+        Reading reading;
+
+        if (readEvent(fd, reading) && reading.enabled > 0)
+            coverage = juce::jmin(coverage, (double) reading.running / (double) reading.enabled);
+    }
+   #endif
+
+    return coverage;
+}
+
+bool PerfCounters::Counts::anyMultiplexed() const noexcept
+{
+    for (size_t event = 0; event < multiplexed.size(); ++event)
+        if (counted[event] && multiplexed[event])
+            return true;
+
+    return false;
+}
+
+PerfCounters::Group PerfCounters::getGroup(Event event) noexcept
+{
+    switch (event)
+    {
+        case l1dMisses:
+        case l2Misses:
+        case llcMisses:     return cacheGroup;
+
+        case cycles:
+        case instructions:
+        case branchMisses:
+        case numEvents:
+        default:            break;
+    }
+
+    return coreGroup;
+}
+
+const char* PerfCounters::getName(Event event) noexcept
+{
+    switch (event)
+    {
+        case cycles:        return "cycles";
+        case instructions:  return "instructions";
+        case l1dMisses:     return "l1dMisses";
+        case l2Misses:      return "l2Misses";
+        case llcMisses:     return "llcMisses";
+        case branchMisses:  return "branchMisses";
+        case numEvents:
+        default:            break;
+    }
+
+    return "";
+}
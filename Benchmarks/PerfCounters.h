@@ -0,0 +1,89 @@
+#pragma once
+
+#include <JuceHeader.h>
+
+//==============================================================================
+/**
+    The CPU's own counts of cycles, instructions, cache misses and branch
+    misses for the calling thread, read through perf_event_open.
+
+    The counters are opened in two groups of three, cycles, instructions and
+    branch misses in one and the three cache misses in the other, so that each
+    group fits in the four general-purpose counters most cores have without
+    the kernel taking turns inside it. Events in a group count over exactly
+    the same stretches of code, and only while started. They count user-space
+    work only, so the start() and stop() calls around a stage add almost
+    nothing to what is measured. If the two groups still have to take turns
+    (because of a hypervisor, the NMI watchdog or another perf session), the
+    totals are scaled up by the share of time each was counting, the event is
+    marked as multiplexed, and getCoverage() says how much that share was.
+
+    Linux only. Elsewhere, or where the kernel refuses (a virtual machine with
+    no PMU, or perf_event_paranoid set above 2), nothing opens and
+    isAvailable() is false. Generic perf events have no L2 miss count, so that
+    one is a raw event for Intel and AMD CPUs and is missing on anything else.
+*/
+class PerfCounters
+{
+public:
+    enum Event
+    {
+        cycles,
+        instructions,
+        l1dMisses,          // L1 data cache read misses
+        l2Misses,
+        llcMisses,          // last-level cache misses
+        branchMisses,
+        numEvents
+    };
+
+    struct Counts
+    {
+        std::array<double, numEvents> values {};
+        std::array<bool, numEvents> counted {};     // false if the event couldn't be opened or never ran
+        std::array<bool, numEvents> multiplexed {}; // true if it ran for less time than it was enabled, so the value is scaled up
+
+        /** True if any counted event had to be scaled up. */
+        bool anyMultiplexed() const noexcept;
+    };
+
+    /** Opens the counters for the calling thread, stopped and at zero. */
+    PerfCounters();
+    ~PerfCounters();
+
+    /** True if at least one of the events opened. */
+    bool isAvailable() const noexcept;
+
+    /** Why nothing opened, if it didn't. */
+    juce::String getError() const { return error; }
+
+    void start() noexcept;
+    void stop() noexcept;
+    void reset() noexcept;
+
+    /** The totals since the last reset(), scaled for multiplexing. */
+    Counts read() const noexcept;
+
+    /** The smallest share of the started time that any open event was
+        actually counting, from 0 to 1.
+    */
+    double getCoverage() const noexcept;
+
+    static const char* getName(Event event) noexcept;
+
+private:
+    enum Group
+    {
+        coreGroup,          // cycles, instructions, branch misses
+        cacheGroup,         // L1D, L2 and LLC misses
+        numGroups
+    };
+
+    static Group getGroup(Event event) noexcept;
+
+    std::array<int, numEvents> fds;
+    std::array<int, numGroups> leaders;
+    juce::String error;
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR(PerfCounters)
+};
@@ -0,0 +1,221 @@
+/*
+  ==============================================================================
+
+    Runs the processor through a set of scenarios with every processBlock call
+    checked by RealtimeGuard, and fails if any of them allocates, frees, takes
+    a lock or makes a blocking system call.
+
+    Each scenario prepares the processor with its parameters set, which isn't
+    checked, and then runs a few seconds of noise through it. The parameters
+    the scenario automates are changed between blocks with setValue() inside
+    the check, the way a host delivers automation on the audio thread.
+
+    Prints what it finds to stderr and exits with 1 if anything was caught.
+
+    Usage: YetiRealtimeCheck [--blocks N] [--scenario NAME]
+
+  ==============================================================================
+*/
+
+#include <JuceHeader.h>
+#include "PluginProcessor.h"
+#include "RealtimeGuard.h"
+
+namespace
+{
+    struct Options
+    {
+        int numBlocks = 400;
+        juce::String scenario;      // only run the scenario with this name, if set
+    };
+
+    struct Setting
+    {
+        const char* parameterID;
+        float value;                // in the parameter's own range
+    };
+
+    struct Scenario
+    {
+        const char* name;
+        std::vector<Setting> settings;
+        std::vector<const char*> automated;     // swept between blocks
+        int mainChannels = 2;
+        int sendChannels = 0;
+        bool toggleBypass = false;
+    };
+
+    constexpr double sampleRate = 48000.0;
+    constexpr int blockSize = 256;
+
+    //==============================================================================
+    void setParameter(juce::AudioProcessorValueTreeState& apvts, const char* parameterID, float value)
+    {
+        auto* parameter = apvts.getParameter(parameterID);
+        jassert(parameter != nullptr);
+        parameter->setValueNotifyingHost(parameter->convertTo0to1(value));
+    }
+
+    /** Sets the processor's buses to the scenario's layout and prepares it. */
+    void prepareProcessor(YetiReverbAudioProcessor& processor, const Scenario& scenario)
+    {
+        const auto mainSet = juce::AudioChannelSet::canonicalChannelSet(scenario.mainChannels);
+        auto layout = processor.getBusesLayout();
+        layout.inputBuses.getReference(0) = mainSet;
+        layout.outputBuses.getReference(0) = mainSet;
+
+        for (int bus = 1; bus < layout.inputBuses.size(); ++bus)
+            layout.inputBuses.getReference(bus) = bus == 1 && scenario.sendChannels > 0
+                                                      ? juce::AudioChannelSet::canonicalChannelSet(scenario.sendChannels)
+                                                      : juce::AudioChannelSet::disabled();
+
+        const auto supported = processor.setBusesLayout(layout);
+        jassertquiet(supported);
+
+        processor.setRateAndBufferSizeDetails(sampleRate, blockSize);
+        processor.prepareToPlay(sampleRate, blockSize);
+    }
+
+    /** Runs the scenario and returns the number of violations caught. */
+    int runScenario(const Scenario& scenario, const Options& options)
+    {
+        YetiReverbAudioProcessor processor;
+        auto& apvts = processor.apvts;
+
+        for (const auto& setting : scenario.settings)
+            setParameter(apvts, setting.parameterID, setting.value);
+
+        prepareProcessor(processor, scenario);
+
+        const auto numChannels = processor.getTotalNumInputChannels();
+        juce::AudioBuffer<float> buffer(juce::jmax(numChannels, processor.getTotalNumOutputChannels()), blockSize);
+        juce::MidiBuffer midi;
+        juce::Random random(1);
+
+        std::vector<juce::RangedAudioParameter*> automated;
+
+        for (const auto* parameterID : scenario.automated)
+            automated.push_back(apvts.getParameter(parameterID));
+
+        auto* bypass = apvts.getParameter(ParamIDs::bypass);
+
+        RealtimeGuard::reset();
+
+        for (int block = 0; block < options.numBlocks; ++block)
+        {
+            // Noise for the first half, then silence so the tails ring out.
+            if (block < options.numBlocks / 2)
+            {
+                for (int channel = 0; channel < buffer.getNumChannels(); ++channel)
+                    for (int i = 0; i < blockSize; ++i)
+                        buffer.setSample(channel, i, (random.nextFloat() * 2.0f - 1.0f) * 0.25f);
+            }
+            else
+            {
+                buffer.clear();
+            }
+
+            const auto sweep = (float) block / (float) options.numBlocks;
+
+            const RealtimeGuard::ScopedCheck check;
+
+            for (auto* parameter : automated)
+                parameter->setValue(std::fmod(sweep * 7.0f, 1.0f));
+
+            if (scenario.toggleBypass && block % 50 == 49)
+                bypass->setValue(bypass->getValue() < 0.5f ? 1.0f : 0.0f);
+
+            processor.processBlock(buffer, midi);
+        }
+
+        auto total = 0;
+
+        for (int kind = 0; kind < RealtimeGuard::numKinds; ++kind)
+            total += RealtimeGuard::getCount((RealtimeGuard::Kind) kind);
+
+        return total;
+    }
+
+    /** Prints the counts and the first few stack traces. Frames in the
+        plugin's own code show as offsets, since its symbols are hidden; pass
+        them to addr2line -Cfe with the path of this executable.
+    */
+    void printViolations()
+    {
+        for (int kind = 0; kind < RealtimeGuard::numKinds; ++kind)
+            if (const auto count = RealtimeGuard::getCount((RealtimeGuard::Kind) kind))
+                std::fprintf(stderr, "    %d %s%s\n", count, RealtimeGuard::getName((RealtimeGuard::Kind) kind),
+                             count == 1 ? "" : "s");
+
+        for (const auto& violation : RealtimeGuard::getViolations())
+            std::fprintf(stderr, "\n    %s in %s from:\n%s\n", RealtimeGuard::getName(violation.kind),
+                         violation.function, violation.stackTrace.toRawUTF8());
+    }
+
+    //==============================================================================
+    const Scenario scenarios[] = {
+        { "freeverb",       {}, {} },
+        { "freeverbEco",    { { ParamIDs::quality, 0.0f } }, {} },
+        { "freeverbHigh",   { { ParamIDs::quality, 2.0f } }, {} },
+        { "adaptive",       { { ParamIDs::adaptiveQuality, 1.0f } }, {} },
+        { "velvet",         { { ParamIDs::algorithm, 1.0f } }, {} },
+        { "plate",          { { ParamIDs::algorithm, 2.0f } }, {} },
+        { "multiband",      { { ParamIDs::multiband, 1.0f } },
+                            { ParamIDs::lowDecay, ParamIDs::highDecay } },
+        { "earlyReflections", { { ParamIDs::earlyLevel, 0.6f } },
+                            { ParamIDs::earlyTaps } },
+        { "character",      { { ParamIDs::warmth, 0.7f }, { ParamIDs::modulation, 0.5f }, { ParamIDs::shimmer, 0.5f } }, {} },
+        { "mono",           { { ParamIDs::earlyLevel, 0.6f }, { ParamIDs::shimmer, 0.5f } }, {}, 1 },
+        { "sends",          {}, {}, 2, 2 },
+        { "bypass",         {}, {}, 2, 0, true },
+        { "automation",     {},
+                            { ParamIDs::size, ParamIDs::damp, ParamIDs::width, ParamIDs::mix,
+                              ParamIDs::lowshelf, ParamIDs::highshelf, ParamIDs::algorithm, ParamIDs::quality } },
+    };
+
+    Options parseOptions(const juce::StringArray& args)
+    {
+        Options options;
+
+        for (int i = 0; i < args.size(); ++i)
+        {
+            if (args[i] == "--blocks")
+                options.numBlocks = juce::jmax(1, args[++i].getIntValue());
+            else if (args[i] == "--scenario")
+                options.scenario = args[++i];
+        }
+
+        return options;
+    }
+}
+
+int main(int argc, char* argv[])
+{
+    juce::ScopedJuceInitialiser_GUI juceInitialiser;
+    RealtimeGuard::initialise();
+
+    juce::StringArray args;
+
+    for (int i = 1; i < argc; ++i)
+        args.add(argv[i]);
+
+    const auto options = parseOptions(args);
+    auto failures = 0;
+
+    for (const auto& scenario : scenarios)
+    {
+        if (options.scenario.isNotEmpty() && options.scenario != scenario.name)
+            continue;
+
+        const auto numViolations = runScenario(scenario, options);
+        std::fprintf(stderr, "%-18s %s\n", scenario.name, numViolations == 0 ? "ok" : "FAILED");
+
+        if (numViolations > 0)
+        {
+            printViolations();
+            ++failures;
+        }
+    }
+
+    return failures == 0 ? 0 : 1;
+}
@@ -0,0 +1,427 @@
+#include "RealtimeGuard.h"
+
+#include <cxxabi.h>
+#include <dlfcn.h>
+#include <fcntl.h>
+#include <pthread.h>
+#include <sys/mman.h>
+#include <cstdarg>
+#include <new>
+
+extern "C"
+{
+    void* __libc_malloc(size_t);
+    void* __libc_calloc(size_t, size_t);
+    void* __libc_realloc(void*, size_t);
+    void* __libc_memalign(size_t, size_t);
+    void __libc_free(void*);
+}
+
+namespace
+{
+    thread_local bool checking = false;
+
+    // Set while a violation is being recorded, or a real function looked up,
+    // so the allocations that does aren't reported in turn.
+    thread_local bool recording = false;
+
+    std::atomic<int> counts[RealtimeGuard::numKinds];
+    std::vector<RealtimeGuard::Violation> violations;
+
+    /** Replaces each mangled name in a backtrace with its demangled form. */
+    juce::String demangle(const juce::String& backtrace)
+    {
+        juce::StringArray lines;
+        lines.addLines(backtrace);
+
+        for (auto& line : lines)
+        {
+            const auto start = line.indexOfChar('(') + 1;
+            const auto end = line.indexOfChar(start, '+');
+
+            if (start <= 0 || end <= start)
+                continue;
+
+            int status = 0;
+            auto* name = abi::__cxa_demangle(line.substring(start, end).toRawUTF8(), nullptr, nullptr, &status);
+
+            if (status == 0 && name != nullptr)
+                line = line.replaceSection(start, end - start, name);
+
+            ::free(name);
+        }
+
+        return lines.joinIntoString("\n");
+    }
+
+    void check(RealtimeGuard::Kind kind, const char* function)
+    {
+        if (! checking || recording)
+            return;
+
+        ++counts[kind];
+
+        if ((int) violations.size() < RealtimeGuard::maxStackTraces)
+        {
+            recording = true;
+            violations.push_back({ kind, function, demangle(juce::SystemStats::getStackBacktrace()) });
+            recording = false;
+        }
+    }
+
+    template <typename Function>
+    void resolve(Function*& real, const char* name)
+    {
+        if (real == nullptr)
+        {
+            const juce::ScopedValueSetter<bool> setter(recording, true);
+            real = reinterpret_cast<Function*>(dlsym(RTLD_NEXT, name));
+        }
+    }
+
+    int (*realMutexLock)(pthread_mutex_t*);
+    int (*realMutexTryLock)(pthread_mutex_t*);
+    int (*realReadLock)(pthread_rwlock_t*);
+    int (*realWriteLock)(pthread_rwlock_t*);
+    ssize_t (*realRead)(int, void*, size_t);
+    ssize_t (*realWrite)(int, const void*, size_t);
+    int (*realOpen)(const char*, int, ...);
+    int (*realOpenAt)(int, const char*, int, ...);
+    int (*realClose)(int);
+    int (*realNanosleep)(const timespec*, timespec*);
+    int (*realClockNanosleep)(clockid_t, int, const timespec*, timespec*);
+    int (*realUsleep)(useconds_t);
+    int (*realSchedYield)();
+    void* (*realMmap)(void*, size_t, int, int, int, off_t);
+    int (*realMunmap)(void*, size_t);
+    long (*realSyscall)(long, ...);
+
+    void* allocate(size_t size, const char* function) noexcept
+    {
+        check(RealtimeGuard::allocation, function);
+        return __libc_malloc(juce::jmax<size_t>(1, size));
+    }
+
+    void* allocateAligned(size_t size, std::align_val_t alignment, const char* function) noexcept
+    {
+        check(RealtimeGuard::allocation, function);
+        return __libc_memalign((size_t) alignment, juce::jmax<size_t>(1, size));
+    }
+
+    void* orThrow(void* pointer)
+    {
+        if (pointer == nullptr)
+            throw std::bad_alloc();
+
+        return pointer;
+    }
+
+    void deallocate(void* pointer, const char* function)
+    {
+        if (pointer != nullptr)
+            check(RealtimeGuard::deallocation, function);
+
+        __libc_free(pointer);
+    }
+
+    /** Whether open() and openat() were passed a mode, which they only are
+        when the call can create a file. Reading one that wasn't is undefined.
+    */
+    bool takesMode(int flags) noexcept
+    {
+       #ifdef O_TMPFILE
+        if ((flags & O_TMPFILE) == O_TMPFILE)
+            return true;
+       #endif
+
+        return (flags & O_CREAT) != 0;
+    }
+}
+
+//==============================================================================
+RealtimeGuard::ScopedCheck::ScopedCheck() noexcept   { checking = true; }
+RealtimeGuard::ScopedCheck::~ScopedCheck() noexcept  { checking = false; }
+
+void RealtimeGuard::initialise()
+{
+    resolve(realMutexLock, "pthread_mutex_lock");
+    resolve(realMutexTryLock, "pthread_mutex_trylock");
+    resolve(realReadLock, "pthread_rwlock_rdlock");
+    resolve(realWriteLock, "pthread_rwlock_wrlock");
+    resolve(realRead, "read");
+    resolve(realWrite, "write");
+    resolve(realOpen, "open");
+    resolve(realOpenAt, "openat");
+    resolve(realClose, "close");
+    resolve(realNanosleep, "nanosleep");
+    resolve(realClockNanosleep, "clock_nanosleep");
+    resolve(realUsleep, "usleep");
+    resolve(realSchedYield, "sched_yield");
+    resolve(realMmap, "mmap");
+    resolve(realMunmap, "munmap");
+    resolve(realSyscall, "syscall");
+
+    violations.reserve((size_t) maxStackTraces);
+}
+
+int RealtimeGuard::getCount(Kind kind) noexcept
+{
+    return counts[kind].load();
+}
+
+std::vector<RealtimeGuard::Violation> RealtimeGuard::getViolations()
+{
+    return violations;
+}
+
+void RealtimeGuard::reset()
+{
+    for (auto& count : counts)
+        count = 0;
+
+    violations.clear();
+}
+
+const char* RealtimeGuard::getName(Kind kind) noexcept
+{
+    switch (kind)
+    {
+        case allocation:    return "allocation";
+        case deallocation:  return "deallocation";
+        case lock:          return "lock";
+        case systemCall:    return "system call";
+        case numKinds:      break;
+    }
+
+    return "";
+}
+
+//==============================================================================
+// The hooks. These take precedence over libc's own because the executable is
+// linked with its symbols exported.
+
+extern "C"
+{
+    void* malloc(size_t size)
+    {
+        check(RealtimeGuard::allocation, "malloc");
+        return __libc_malloc(size);
+    }
+
+    void* calloc(size_t count, size_t size)
+    {
+        check(RealtimeGuard::allocation, "calloc");
+        return __libc_calloc(count, size);
+    }
+
+    void* realloc(void* pointer, size_t size)
+    {
+        check(RealtimeGuard::allocation, "realloc");
+        return __libc_realloc(pointer, size);
+    }
+
+    void* memalign(size_t alignment, size_t size)
+    {
+        check(RealtimeGuard::allocation, "memalign");
+        return __libc_memalign(alignment, size);
+    }
+
+    void* aligned_alloc(size_t alignment, size_t size)
+    {
+        check(RealtimeGuard::allocation, "aligned_alloc");
+        return __libc_memalign(alignment, size);
+    }
+
+    int posix_memalign(void** result, size_t alignment, size_t size)
+    {
+        check(RealtimeGuard::allocation, "posix_memalign");
+        *result = __libc_memalign(alignment, size);
+        return *result != nullptr || size == 0 ? 0 : ENOMEM;
+    }
+
+    void free(void* pointer)
+    {
+        if (pointer != nullptr)
+            check(RealtimeGuard::deallocation, "free");
+
+        __libc_free(pointer);
+    }
+
+    //==============================================================================
+    int pthread_mutex_lock(pthread_mutex_t* mutex)
+    {
+        check(RealtimeGuard::lock, "pthread_mutex_lock");
+        resolve(realMutexLock, "pthread_mutex_lock");
+        return realMutexLock(mutex);
+    }
+
+    int pthread_mutex_trylock(pthread_mutex_t* mutex)
+    {
+        check(RealtimeGuard::lock, "pthread_mutex_trylock");
+        resolve(realMutexTryLock, "pthread_mutex_trylock");
+        return realMutexTryLock(mutex);
+    }
+
+    int pthread_rwlock_rdlock(pthread_rwlock_t* rwlock)
+    {
+        check(RealtimeGuard::lock, "pthread_rwlock_rdlock");
+        resolve(realReadLock, "pthread_rwlock_rdlock");
+        return realReadLock(rwlock);
+    }
+
+    int pthread_rwlock_wrlock(pthread_rwlock_t* rwlock)
+    {
+        check(RealtimeGuard::lock, "pthread_rwlock_wrlock");
+        resolve(realWriteLock, "pthread_rwlock_wrlock");
+        return realWriteLock(rwlock);
+    }
+
+    //==============================================================================
+    ssize_t read(int fd, void* buffer, size_t size)
+    {
+        check(RealtimeGuard::systemCall, "read");
+        resolve(realRead, "read");
+        return realRead(fd, buffer, size);
+    }
+
+    ssize_t write(int fd, const void* buffer, size_t size)
+    {
+        check(RealtimeGuard::systemCall, "write");
+        resolve(realWrite, "write");
+        return realWrite(fd, buffer, size);
+    }
+
+    int open(const char* path, int flags, ...)
+    {
+        check(RealtimeGuard::systemCall, "open");
+        resolve(realOpen, "open");
+
+        mode_t mode = 0;
+
+        if (takesMode(flags))
+        {
+            va_list args;
+            va_start(args, flags);
+            mode = va_arg(args, mode_t);
+            va_end(args);
+        }
+
+        return realOpen(path, flags, mode);
+    }
+
+    int openat(int dirfd, const char* path, int flags, ...)
+    {
+        check(RealtimeGuard::systemCall, "openat");
+        resolve(realOpenAt, "openat");
+
+        mode_t mode = 0;
+
+        if (takesMode(flags))
+        {
+            va_list args;
+            va_start(args, flags);
+            mode = va_arg(args, mode_t);
+            va_end(args);
+        }
+
+        return realOpenAt(dirfd, path, flags, mode);
+    }
+
+    int close(int fd)
+    {
+        check(RealtimeGuard::systemCall, "close");
+        resolve(realClose, "close");
+        return realClose(fd);
+    }
+
+    int nanosleep(const timespec* duration, timespec* remaining)
+    {
+        check(RealtimeGuard::systemCall, "nanosleep");
+        resolve(realNanosleep, "nanosleep");
+        return realNanosleep(duration, remaining);
+    }
+
+    int clock_nanosleep(clockid_t clock, int flags, const timespec* duration, timespec* remaining)
+    {
+        check(RealtimeGuard::systemCall, "clock_nanosleep");
+        resolve(realClockNanosleep, "clock_nanosleep");
+        return realClockNanosleep(clock, flags, duration, remaining);
+    }
+
+    int usleep(useconds_t microseconds)
+    {
+        check(RealtimeGuard::systemCall, "usleep");
+        resolve(realUsleep, "usleep");
+        return realUsleep(microseconds);
+    }
+
+    int sched_yield()
+    {
+        check(RealtimeGuard::systemCall, "sched_yield");
+        resolve(realSchedYield, "sched_yield");
+        return realSchedYield();
+    }
+
+    void* mmap(void* address, size_t length, int protection, int flags, int fd, off_t offset)
+    {
+        check(RealtimeGuard::systemCall, "mmap");
+        resolve(realMmap, "mmap");
+        return realMmap(address, length, protection, flags, fd, offset);
+    }
+
+    int munmap(void* address, size_t length)
+    {
+        check(RealtimeGuard::systemCall, "munmap");
+        resolve(realMunmap, "munmap");
+        return realMunmap(address, length);
+    }
+
+    long syscall(long number, ...)
+    {
+        check(RealtimeGuard::systemCall, "syscall");
+        resolve(realSyscall, "syscall");
+
+        // Every Linux system call takes at most six word-sized arguments.
+        va_list args;
+        va_start(args, number);
+        long a[6];
+
+        for (auto& arg : a)
+            arg = va_arg(args, long);
+
+        va_end(args);
+        return realSyscall(number, a[0], a[1], a[2], a[3], a[4], a[5]);
+    }
+}
+
+//==============================================================================
+void* operator new (size_t size)                                  { return orThrow(allocate(size, "operator new")); }
+void* operator new[] (size_t size)                                { return orThrow(allocate(size, "operator new[]")); }
+void* operator new (size_t size, const std::nothrow_t&) noexcept   { return allocate(size, "operator new"); }
+void* operator new[] (size_t size, const std::nothrow_t&) noexcept { return allocate(size, "operator new[]"); }
+
+void* operator new (size_t size, std::align_val_t alignment)     { return orThrow(allocateAligned(size, alignment, "operator new")); }
+void* operator new[] (size_t size, std::align_val_t alignment)   { return orThrow(allocateAligned(size, alignment, "operator new[]")); }
+
+void* operator new (size_t size, std::align_val_t alignment, const std::nothrow_t&) noexcept
+{
+    return allocateAligned(size, alignment, "operator new");
+}
+
+void* operator new[] (size_t size, std::align_val_t alignment, const std::nothrow_t&) noexcept
+{
+    return allocateAligned(size, alignment, "operator new[]");
+}
+
+void operator delete (void* pointer) noexcept                                     { deallocate(pointer, "operator delete"); }
+void operator delete[] (void* pointer) noexcept                                   { deallocate(pointer, "operator delete[]"); }
+void operator delete (void* pointer, size_t) noexcept                             { deallocate(pointer, "operator delete"); }
+void operator delete[] (void* pointer, size_t) noexcept                           { deallocate(pointer, "operator delete[]"); }
+void operator delete (void* pointer, const std::nothrow_t&) noexcept              { deallocate(pointer, "operator delete"); }
+void operator delete[] (void* pointer, const std::nothrow_t&) noexcept            { deallocate(pointer, "operator delete[]"); }
+void operator delete (void* pointer, std::align_val_t) noexcept                   { deallocate(pointer, "operator delete"); }
+void operator delete[] (void* pointer, std::align_val_t) noexcept                 { deallocate(pointer, "operator delete[]"); }
+void operator delete (void* pointer, size_t, std::align_val_t) noexcept           { deallocate(pointer, "operator delete"); }
+void operator delete[] (void* pointer, size_t, std::align_val_t) noexcept         { deallocate(pointer, "operator delete[]"); }
+void operator delete (void* pointer, std::align_val_t, const std::nothrow_t&) noexcept   { deallocate(pointer, "operator delete"); }
+void operator delete[] (void* pointer, std::align_val_t, const std::nothrow_t&) noexcept { deallocate(pointer, "operator delete[]"); }
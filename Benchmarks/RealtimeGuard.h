@@ -0,0 +1,70 @@
+#pragma once
+
+#include <JuceHeader.h>
+
+//==============================================================================
+/**
+    Catches a thread doing anything that can block while it is meant to be
+    real-time.
+
+    RealtimeGuard.cpp replaces malloc, free and the other C allocation
+    functions, every form of operator new and delete, the pthread mutex and
+    rwlock locks, and the system calls that usually end up in an audio
+    callback by accident (file I/O, sleeping, mapping memory and raw
+    syscall()). Each replacement checks whether the calling thread is inside a
+    ScopedCheck and, if so, records a violation before doing what was asked.
+    Other threads pay for one thread-local read.
+
+    Only calls that go through the dynamic linker are seen. Spin locks built
+    on atomics, condition variables and anything libc does internally are not,
+    but none of those can happen without one of the calls that are.
+
+    Linux only, since it relies on glibc's __libc_malloc family and RTLD_NEXT.
+*/
+struct RealtimeGuard
+{
+    enum Kind
+    {
+        allocation,
+        deallocation,
+        lock,
+        systemCall,
+        numKinds
+    };
+
+    struct Violation
+    {
+        Kind kind;
+        const char* function;
+        juce::String stackTrace;
+    };
+
+    /** Checks the calling thread for as long as it exists. */
+    struct ScopedCheck
+    {
+        ScopedCheck() noexcept;
+        ~ScopedCheck() noexcept;
+
+        JUCE_DECLARE_NON_COPYABLE(ScopedCheck)
+    };
+
+    /** Looks up the real functions behind the hooks. Call once, before the
+        first ScopedCheck, so the lookup itself is never mistaken for a
+        violation.
+    */
+    static void initialise();
+
+    /** How many violations of the kind have been seen since the last reset(). */
+    static int getCount(Kind kind) noexcept;
+
+    /** The first few violations since the last reset(), with where they came
+        from. Later ones are only counted.
+    */
+    static std::vector<Violation> getViolations();
+
+    static void reset();
+
+    static const char* getName(Kind kind) noexcept;
+
+    static constexpr int maxStackTraces = 8;
+};
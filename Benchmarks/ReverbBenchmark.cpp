@@ -0,0 +1,839 @@
+/*
+  ==============================================================================
+
+    Times the whole processor and each of its stages on their own, across
+    sample rates, block sizes and channel layouts, and writes the results as
+    JSON.
+
+    With --instances, it instead runs 1, 2, 4 ... up to N processors side by
+    side, one block each in turn the way a host does, to show how the cost
+    per instance grows once their combined memory spills out of each cache.
+
+    With --engines, it times each reverb engine on its own at one sample rate
+    and block size, in stereo, against juce::dsp::Reverb and the Standard
+    Freeverb tier.
+
+    With --split, it times the Standard Freeverb network in stereo with and
+    without a RenderWorker sharing its channels, across block sizes, and the
+    worker's hand-off on its own, to show where splitting starts to pay.
+
+    With --counters, it also reads the CPU's performance counters (cycles,
+    instructions, L1/L2/last-level cache misses and branch misses) around
+    each block, on Linux where the kernel allows it. They're counted over a
+    separate run for each stage, so they don't disturb its timing.
+
+    Usage: YetiReverbBench [--quick] [--runs N] [--seconds S] [--stage NAME]
+                           [--counters] [--output FILE]
+           YetiReverbBench --instances [N] [--sample-rate HZ] [--block-size N]
+                           [--seconds S] [--counters] [--output FILE]
+           YetiReverbBench --engines [--sample-rate HZ] [--block-size N]
+                           [--runs N] [--seconds S] [--output FILE]
+           YetiReverbBench --split [--sample-rate HZ] [--runs N] [--seconds S]
+                           [--output FILE]
+
+  ==============================================================================
+*/
+
+#include <JuceHeader.h>
+#include "PluginProcessor.h"
+#include "PerfCounters.h"
+#include "LoadStatisticsJson.h"
+
+namespace
+{
+    struct Options
+    {
+        bool quick = false;
+        int runs = 5;
+        double seconds = 0.25;      // of audio per run
+        juce::String stage;         // only run stages with this name, if set
+        juce::File output;          // stdout if not set
+        bool counters = false;      // read the hardware performance counters too
+
+        int maxInstances = 0;       // runs the scaling sweep instead, if set
+        bool engines = false;       // runs the engine comparison instead
+        bool split = false;         // runs the render worker sweep instead
+        double sampleRate = 48000.0;
+        int blockSize = 512;
+    };
+
+    struct Layout
+    {
+        const char* name;
+        int mainChannels;
+        int sendChannels;           // on the first send bus; only the processor has one
+    };
+
+    struct Config
+    {
+        double sampleRate;
+        int blockSize;
+        Layout layout;
+    };
+
+    struct Result
+    {
+        double mean = 0.0, min = 0.0, variance = 0.0;   // in ns per sample frame
+        juce::var blockLoad;                            // the processor's LoadStatistics, for the whole processor only
+        juce::var counters;                             // per sample frame, with --counters
+    };
+
+    /** The counters' totals per sample frame, or void if none could be read. */
+    juce::var toJson(const PerfCounters& counters, double numSampleFrames)
+    {
+        if (! counters.isAvailable())
+            return {};
+
+        const auto counts = counters.read();
+        auto* object = new juce::DynamicObject();
+
+        for (int event = 0; event < PerfCounters::numEvents; ++event)
+            object->setProperty(juce::String(PerfCounters::getName((PerfCounters::Event) event)) + "PerSample",
+                                counts.counted[(size_t) event] ? juce::var(counts.values[(size_t) event] / numSampleFrames)
+                                                               : juce::var());
+
+        if (counts.counted[PerfCounters::cycles] && counts.counted[PerfCounters::instructions] && counts.values[PerfCounters::cycles] > 0.0)
+            object->setProperty("instructionsPerCycle", counts.values[PerfCounters::instructions] / counts.values[PerfCounters::cycles]);
+
+        object->setProperty("coverage", counters.getCoverage());
+        object->setProperty("multiplexed", counts.anyMultiplexed());
+        return object;
+    }
+
+    //==============================================================================
+    /** Calls processBlock on a buffer refilled with noise before each block, for
+        options.runs timed runs of options.seconds each after one untimed one.
+        The times are per sample frame, i.e. per sample of every channel at once.
+    */
+    template <typename ProcessBlock>
+    Result measure(const Config& config, const Options& options, int numChannels, ProcessBlock&& processBlock)
+    {
+        const auto blockSize = config.blockSize;
+        const auto numBlocks = juce::jmax(1, (int) std::ceil(options.seconds * config.sampleRate / blockSize));
+
+        // A few blocks' worth of noise to copy from, so the copying stays in cache.
+        const auto sourceLength = blockSize * 4;
+        juce::AudioBuffer<float> source(numChannels, sourceLength), buffer(numChannels, blockSize);
+        juce::Random random(1);
+
+        for (int channel = 0; channel < numChannels; ++channel)
+            for (int i = 0; i < sourceLength; ++i)
+                source.setSample(channel, i, (random.nextFloat() * 2.0f - 1.0f) * 0.25f);
+
+        const auto fillBuffer = [&](int b)
+        {
+            const auto offset = (b % 4) * blockSize;
+
+            for (int channel = 0; channel < numChannels; ++channel)
+                buffer.copyFrom(channel, 0, source, channel, offset, blockSize);
+        };
+
+        juce::ScopedNoDenormals noDenormals;
+        std::vector<double> perRun;
+
+        for (int run = 0; run <= options.runs; ++run)
+        {
+            const auto start = juce::Time::getHighResolutionTicks();
+
+            for (int b = 0; b < numBlocks; ++b)
+            {
+                fillBuffer(b);
+                processBlock(buffer);
+            }
+
+            const auto elapsed = juce::Time::highResolutionTicksToSeconds(juce::Time::getHighResolutionTicks() - start);
+
+            if (run > 0)
+                perRun.push_back(elapsed * 1.0e9 / ((double) numBlocks * blockSize));
+        }
+
+        Result result;
+        result.mean = std::accumulate(perRun.begin(), perRun.end(), 0.0) / (double) perRun.size();
+        result.min = *std::min_element(perRun.begin(), perRun.end());
+
+        for (const auto ns : perRun)
+            result.variance += (ns - result.mean) * (ns - result.mean);
+
+        result.variance /= (double) juce::jmax<size_t>(1, perRun.size() - 1);
+
+        if (options.counters)
+        {
+            PerfCounters counters;
+
+            for (int b = 0; b < numBlocks; ++b)
+            {
+                fillBuffer(b);
+
+                counters.start();
+                processBlock(buffer);
+                counters.stop();
+            }
+
+            result.counters = toJson(counters, (double) numBlocks * blockSize);
+        }
+
+        return result;
+    }
+
+    /** Sets the processor's buses to the layout and prepares it. */
+    void prepareProcessor(YetiReverbAudioProcessor& processor, const Config& config)
+    {
+        const auto mainSet = juce::AudioChannelSet::canonicalChannelSet(config.layout.mainChannels);
+        auto layout = processor.getBusesLayout();
+        layout.inputBuses.getReference(0) = mainSet;
+        layout.outputBuses.getReference(0) = mainSet;
+
+        for (int bus = 1; bus < layout.inputBuses.size(); ++bus)
+            layout.inputBuses.getReference(bus) = bus == 1 && config.layout.sendChannels > 0
+                                                      ? juce::AudioChannelSet::canonicalChannelSet(config.layout.sendChannels)
+                                                      : juce::AudioChannelSet::disabled();
+
+        const auto supported = processor.setBusesLayout(layout);
+        jassertquiet(supported);
+
+        processor.setRateAndBufferSizeDetails(config.sampleRate, config.blockSize);
+        processor.prepareToPlay(config.sampleRate, config.blockSize);
+    }
+
+    juce::dsp::ProcessSpec makeSpec(const Config& config)
+    {
+        return { config.sampleRate, (juce::uint32) config.blockSize, (juce::uint32) config.layout.mainChannels };
+    }
+
+    juce::Reverb::Parameters makeParameters()
+    {
+        juce::Reverb::Parameters params;
+        params.roomSize = 0.5f;
+        params.damping = 0.5f;
+        params.width = 0.5f;
+        params.wetLevel = 0.5f;
+        return params;
+    }
+
+    //==============================================================================
+    Result measureProcessor(const Config& config, const Options& options)
+    {
+        YetiReverbAudioProcessor processor;
+        prepareProcessor(processor, config);
+
+        juce::MidiBuffer midi;
+        const auto numChannels = juce::jmax(processor.getTotalNumInputChannels(), processor.getTotalNumOutputChannels());
+
+        auto result = measure(config, options, numChannels, [&](juce::AudioBuffer<float>& buffer)
+        {
+            processor.processBlock(buffer, midi);
+        });
+
+        // Counted by the processor itself, over every run including the untimed one.
+        result.blockLoad = toJson(processor.getLoadMeter().getStatistics());
+
+        processor.releaseResources();
+        return result;
+    }
+
+    /** Times one of the engines on its own, set up as the processor sets it up. */
+    template <typename Engine, typename Setup>
+    Result measureEngine(const Config& config, const Options& options, Setup&& setup)
+    {
+        auto engine = std::make_unique<Engine>();
+        setup(*engine);
+        engine->prepare(makeSpec(config));
+
+        return measure(config, options, config.layout.mainChannels, [&](juce::AudioBuffer<float>& buffer)
+        {
+            juce::dsp::AudioBlock<float> block(buffer);
+            engine->process(juce::dsp::ProcessContextReplacing<float>(block));
+        });
+    }
+
+    template <typename Engine>
+    Result measureEngine(const Config& config, const Options& options)
+    {
+        return measureEngine<Engine>(config, options, [](Engine& engine) { engine.setParameters(makeParameters()); });
+    }
+
+    Result measureFreeverb(const Config& config, const Options& options, ReverbQuality quality, float modulation = 0.0f)
+    {
+        return measureEngine<TieredFreeverb>(config, options, [quality, modulation](TieredFreeverb& reverb)
+        {
+            reverb.setParameters(makeParameters());
+            reverb.setModulation(modulation);
+            reverb.setQuality(quality);
+        });
+    }
+
+    Result measureEarlyReflections(const Config& config, const Options& options)
+    {
+        EarlyReflections earlyReflections;
+        earlyReflections.setRoom(0.5f, 0.5f, 32);
+        earlyReflections.setLevel(0.5f);
+        earlyReflections.prepare(makeSpec(config));
+
+        return measure(config, options, config.layout.mainChannels, [&](juce::AudioBuffer<float>& buffer)
+        {
+            juce::dsp::AudioBlock<float> block(buffer);
+            earlyReflections.pushInput(block);
+            earlyReflections.addTo(block);
+        });
+    }
+
+    /** The low and high shelves, which run as one fused pass, with the dry
+        signal mixed in first when withDry is set.
+    */
+    Result measureOutputChain(const Config& config, const Options& options, bool withDry)
+    {
+        OutputChain chain;
+        chain.prepare(config.sampleRate);
+        chain.setDryGain(withDry ? 1.0f : 0.0f);
+        chain.setShelves(juce::dsp::IIR::ArrayCoefficients<float>::makeLowShelf(config.sampleRate, 200.0f, 0.707f, 0.25f),
+                         juce::dsp::IIR::ArrayCoefficients<float>::makeHighShelf(config.sampleRate, 8000.0f, 0.707f, 0.25f));
+        chain.reset();
+
+        juce::AudioBuffer<float> dry(config.layout.mainChannels, config.blockSize);
+        dry.clear();
+
+        return measure(config, options, config.layout.mainChannels, [&](juce::AudioBuffer<float>& buffer)
+        {
+            chain.process(juce::dsp::AudioBlock<float>(buffer), dry);
+        });
+    }
+
+    /** The processor under automation: the room size, damping and both shelf
+        frequencies move every block, set through the parameters as the plugin
+        wrappers set them for a host. Compared with processBlock, this is what
+        updating the engine, the early reflections and the shelves costs.
+    */
+    Result measureParameterUpdate(const Config& config, const Options& options)
+    {
+        YetiReverbAudioProcessor processor;
+        prepareProcessor(processor, config);
+
+        juce::RangedAudioParameter* automated[] = { processor.apvts.getParameter(ParamIDs::size),
+                                                    processor.apvts.getParameter(ParamIDs::damp),
+                                                    processor.apvts.getParameter(ParamIDs::lowshelf),
+                                                    processor.apvts.getParameter(ParamIDs::highshelf) };
+
+        juce::MidiBuffer midi;
+        const auto numChannels = juce::jmax(processor.getTotalNumInputChannels(), processor.getTotalNumOutputChannels());
+        int block = 0;
+
+        auto result = measure(config, options, numChannels, [&](juce::AudioBuffer<float>& buffer)
+        {
+            const auto value = 0.4f + 0.2f * (float) (block++ & 7) / 8.0f;
+
+            for (auto* parameter : automated)
+            {
+                parameter->setValue(value);
+                parameter->sendValueChangedMessageToListeners(value);
+            }
+
+            processor.processBlock(buffer, midi);
+        });
+
+        processor.releaseResources();
+        return result;
+    }
+
+    //==============================================================================
+    struct Stage
+    {
+        const char* name;
+        bool runsWithSends;     // also run for the layout with a send bus; only the processor has one
+        Result (*run)(const Config&, const Options&);
+    };
+
+    const Stage stages[] = {
+        { "processBlock",       true,  measureProcessor },
+        { "freeverb",           false, [](const Config& c, const Options& o) { return measureFreeverb(c, o, ReverbQuality::standard); } },
+        { "freeverbEco",        false, [](const Config& c, const Options& o) { return measureFreeverb(c, o, ReverbQuality::eco); } },
+        { "freeverbHigh",       false, [](const Config& c, const Options& o) { return measureFreeverb(c, o, ReverbQuality::high); } },
+        { "freeverbModulated",  false, [](const Config& c, const Options& o) { return measureFreeverb(c, o, ReverbQuality::standard, 1.0f); } },
+        { "juceReverb",         false, measureEngine<juce::dsp::Reverb> },
+        { "velvet",             false, measureEngine<VelvetReverb> },
+        { "plate",              false, measureEngine<PlateReverb> },
+        { "multiband",          false, measureEngine<MultibandReverb> },
+        { "earlyReflections",   false, measureEarlyReflections },
+        { "shelves",            false, [](const Config& c, const Options& o) { return measureOutputChain(c, o, false); } },
+        { "dryAndShelves",      false, [](const Config& c, const Options& o) { return measureOutputChain(c, o, true); } },
+        { "parameterUpdate",    false, measureParameterUpdate }
+    };
+
+    //==============================================================================
+    /** Runs numInstances stereo processors round-robin, one block each per
+        round, with a buffer of their own as a host would give them. Reports
+        what one instance's block cost on average and at worst, and the
+        throughput of all of them together.
+    */
+    juce::var measureInstances(int numInstances, const Options& options)
+    {
+        const Config config { options.sampleRate, options.blockSize, { "stereo", 2, 0 } };
+        const auto numRounds = juce::jmax(4, (int) std::ceil(options.seconds * config.sampleRate / config.blockSize));
+
+        std::vector<std::unique_ptr<YetiReverbAudioProcessor>> processors;
+        std::vector<juce::AudioBuffer<float>> buffers;
+
+        for (int i = 0; i < numInstances; ++i)
+        {
+            processors.push_back(std::make_unique<YetiReverbAudioProcessor>());
+            prepareProcessor(*processors.back(), config);
+            buffers.emplace_back(2, config.blockSize);
+        }
+
+        juce::AudioBuffer<float> source(2, config.blockSize);
+        juce::Random random(1);
+
+        for (int channel = 0; channel < 2; ++channel)
+            for (int i = 0; i < config.blockSize; ++i)
+                source.setSample(channel, i, (random.nextFloat() * 2.0f - 1.0f) * 0.25f);
+
+        juce::MidiBuffer midi;
+        juce::ScopedNoDenormals noDenormals;
+        double totalSeconds = 0.0, worstSeconds = 0.0;
+
+        // Started just outside the timed part of each block, so the counters
+        // only cost the timing a little and count only the processing.
+        std::unique_ptr<PerfCounters> counters;
+
+        if (options.counters)
+            counters = std::make_unique<PerfCounters>();
+
+        // The first round touches every instance's memory for the first time,
+        // so it isn't counted.
+        for (int round = 0; round <= numRounds; ++round)
+        {
+            for (int i = 0; i < numInstances; ++i)
+            {
+                auto& buffer = buffers[(size_t) i];
+
+                for (int channel = 0; channel < 2; ++channel)
+                    buffer.copyFrom(channel, 0, source, channel, 0, config.blockSize);
+
+                const auto counting = counters != nullptr && round > 0;
+
+                if (counting)
+                    counters->start();
+
+                const auto start = juce::Time::getHighResolutionTicks();
+                processors[(size_t) i]->processBlock(buffer, midi);
+                const auto elapsed = juce::Time::highResolutionTicksToSeconds(juce::Time::getHighResolutionTicks() - start);
+
+                if (counting)
+                    counters->stop();
+
+                if (round > 0)
+                {
+                    totalSeconds += elapsed;
+                    worstSeconds = juce::jmax(worstSeconds, elapsed);
+                }
+                else
+                {
+                    processors[(size_t) i]->getLoadMeter().resetStatistics();
+                }
+            }
+        }
+
+        LoadStatistics blockLoad;
+
+        for (const auto& processor : processors)
+            blockLoad += processor->getLoadMeter().getStatistics();
+
+        const auto numBlocks = (double) numRounds * numInstances;
+        const auto perBlockNs = totalSeconds * 1.0e9 / numBlocks;
+        const auto blockSeconds = config.blockSize / config.sampleRate;
+        const auto memoryPerInstance = processors.front()->getMemoryUsage().getTotal();
+
+        auto* object = new juce::DynamicObject();
+        object->setProperty("instances", numInstances);
+        object->setProperty("sampleRate", config.sampleRate);
+        object->setProperty("blockSize", config.blockSize);
+        object->setProperty("nsPerBlockPerInstance", perBlockNs);
+        object->setProperty("nsPerBlockPerInstanceWorst", worstSeconds * 1.0e9);
+        object->setProperty("nsPerSamplePerInstance", perBlockNs / config.blockSize);
+        object->setProperty("aggregateSamplesPerSecond", numBlocks * config.blockSize / totalSeconds);
+        object->setProperty("realtimePercent", 100.0 * numInstances * perBlockNs * 1.0e-9 / blockSeconds);
+        object->setProperty("memoryPerInstance", (juce::int64) memoryPerInstance);
+        object->setProperty("memoryTotal", (juce::int64) (memoryPerInstance * (size_t) numInstances));
+        object->setProperty("blockLoad", toJson(blockLoad));
+
+        if (counters != nullptr)
+            if (const auto counts = toJson(*counters, numBlocks * config.blockSize); ! counts.isVoid())
+                object->setProperty("counters", counts);
+
+        std::fprintf(stderr, "%4d instances  %10.0f ns/block each  %8.2f ns/sample each  %9.2f%% RT  p99.9 %6.2f%%  %8.1f MB\n",
+                     numInstances, perBlockNs, perBlockNs / config.blockSize,
+                     100.0 * numInstances * perBlockNs * 1.0e-9 / blockSeconds,
+                     100.0 * blockLoad.getPercentile(0.999),
+                     (double) (memoryPerInstance * (size_t) numInstances) / (1024.0 * 1024.0));
+
+        return object;
+    }
+
+    /** Times every engine on its own, in stereo at the options' sample rate and
+        block size, and compares each with juce::dsp::Reverb, which the plugin
+        started out with, and with the Standard Freeverb tier. The comparisons
+        use each engine's fastest run, which the rest of the machine disturbs
+        least.
+    */
+    juce::Array<juce::var> compareEngines(const Options& options)
+    {
+        const char* const engineStages[] = { "juceReverb", "freeverbEco", "freeverb", "freeverbHigh", "freeverbModulated",
+                                             "velvet", "plate", "multiband" };
+        const Config config { options.sampleRate, options.blockSize, { "stereo", 2, 0 } };
+
+        std::vector<std::pair<const char*, Result>> results;
+
+        for (const auto* name : engineStages)
+            for (const auto& stage : stages)
+                if (juce::String(stage.name) == name)
+                    results.emplace_back(name, stage.run(config, options));
+
+        const auto findMin = [&](const char* name)
+        {
+            for (const auto& [stageName, result] : results)
+                if (juce::String(stageName) == name)
+                    return result.min;
+
+            return 0.0;
+        };
+
+        const auto juceReverbNs = findMin("juceReverb");
+        const auto freeverbNs = findMin("freeverb");
+
+        juce::Array<juce::var> engines;
+
+        for (const auto& [name, result] : results)
+        {
+            std::fprintf(stderr, "%-18s %10.2f ns/sample (min %8.2f)  %5.2fx juce::dsp::Reverb  %5.2fx freeverb\n",
+                         name, result.mean, result.min, result.min / juceReverbNs, result.min / freeverbNs);
+
+            auto* object = new juce::DynamicObject();
+            object->setProperty("engine", name);
+            object->setProperty("nsPerSample", result.mean);
+            object->setProperty("nsPerSampleMin", result.min);
+            object->setProperty("nsPerSampleStdDev", std::sqrt(result.variance));
+            object->setProperty("relativeToJuceReverb", result.min / juceReverbNs);
+            object->setProperty("relativeToFreeverb", result.min / freeverbNs);
+            engines.add(object);
+        }
+
+        return engines;
+    }
+
+    //==============================================================================
+    /** A task with no work, whose first part waits for the worker to pick up
+        the second, so the caller can't run both halves itself.
+    */
+    struct HandOffTask : RenderWorker::Task
+    {
+        void runPart(int part) noexcept override
+        {
+            if (part == 1)
+                claimed = true;
+            else
+                while (! claimed)
+                    std::this_thread::yield();
+        }
+
+        std::atomic<bool> claimed { false };
+    };
+
+    /** The fastest run's mean time, in microseconds, for the worker to wake,
+        pick up an empty half and be joined again. This is what a split block
+        pays on top of its half of the work.
+    */
+    double measureHandOff(RenderWorker& worker, const Options& options)
+    {
+        constexpr int numCalls = 2000;
+        HandOffTask task;
+        auto fastest = std::numeric_limits<double>::max();
+
+        for (int run = 0; run <= options.runs; ++run)
+        {
+            const auto start = juce::Time::getHighResolutionTicks();
+
+            for (int call = 0; call < numCalls; ++call)
+            {
+                task.claimed = false;
+                worker.runSplit(task);
+            }
+
+            const auto elapsed = juce::Time::highResolutionTicksToSeconds(juce::Time::getHighResolutionTicks() - start);
+
+            if (run > 0)
+                fastest = juce::jmin(fastest, elapsed * 1.0e6 / numCalls);
+        }
+
+        return fastest;
+    }
+
+    /** Times the Standard network in stereo at each block size, on the calling
+        thread alone and with the worker taking the right channel, however
+        long the block. The split only helps once the half of the work it moves
+        outweighs the hand-off, so the hand-off is timed on its own as well.
+
+        The break-even block size is where half the serial cost of a block
+        equals the hand-off, and the suggested minimum is the power of two that
+        keeps the hand-off under a tenth of what the split saves. splitWinsFrom
+        is the smallest measured size from which the split was faster at every
+        larger size, or 0 if it never was. On a single core the worker can only
+        run in the caller's place, so the split timings are just noise and
+        splitWinsFrom is left at 0.
+    */
+    juce::var measureSplit(const Options& options)
+    {
+        RenderWorker worker;
+        worker.start();
+
+        const auto handOffMicroseconds = measureHandOff(worker, options);
+
+        juce::Array<juce::var> sizes;
+        std::vector<std::pair<int, double>> speedups;
+        double serialNsPerSample = 0.0;
+
+        for (int blockSize = 64; blockSize <= 16384; blockSize *= 2)
+        {
+            const Config config { options.sampleRate, blockSize, { "stereo", 2, 0 } };
+
+            const auto run = [&](RenderWorker* renderWorker)
+            {
+                return measureEngine<FreeverbNetwork<>>(config, options, [renderWorker](FreeverbNetwork<>& network)
+                {
+                    network.setParameters(makeParameters());
+                    network.setRenderWorker(renderWorker, 1);
+                });
+            };
+
+            const auto serial = run(nullptr);
+            const auto split = run(&worker);
+            const auto speedup = serial.min / split.min;
+
+            serialNsPerSample = serial.min;
+            speedups.emplace_back(blockSize, speedup);
+
+            std::fprintf(stderr, "%6d  serial %8.2f ns/sample  split %8.2f ns/sample  %5.2fx\n",
+                         blockSize, serial.min, split.min, speedup);
+
+            auto* object = new juce::DynamicObject();
+            object->setProperty("blockSize", blockSize);
+            object->setProperty("serialNsPerSampleMin", serial.min);
+            object->setProperty("splitNsPerSampleMin", split.min);
+            object->setProperty("speedup", speedup);
+            sizes.add(object);
+        }
+
+        worker.stop();
+
+        const auto numCores = juce::SystemStats::getNumCpus();
+        int splitWinsFrom = 0;
+
+        if (numCores > 1)
+            for (auto it = speedups.rbegin(); it != speedups.rend() && it->second > 1.0; ++it)
+                splitWinsFrom = it->first;
+
+        const auto breakEven = handOffMicroseconds * 1000.0 / (0.5 * serialNsPerSample);
+        const auto suggested = juce::nextPowerOfTwo((int) std::ceil(10.0 * breakEven));
+
+        std::fprintf(stderr, "%d cores, hand-off %.2f us, break-even %.0f samples, suggested %d, split wins from %d, minSplitBlockSize %d\n",
+                     numCores, handOffMicroseconds, breakEven, suggested, splitWinsFrom, FreeverbNetwork<>::minSplitBlockSize);
+
+        auto* result = new juce::DynamicObject();
+        result->setProperty("cores", numCores);
+        result->setProperty("handOffMicroseconds", handOffMicroseconds);
+        result->setProperty("breakEvenBlockSize", breakEven);
+        result->setProperty("suggestedMinSplitBlockSize", suggested);
+        result->setProperty("splitWinsFrom", splitWinsFrom);
+        result->setProperty("minSplitBlockSize", FreeverbNetwork<>::minSplitBlockSize);
+        result->setProperty("blockSizes", sizes);
+        return result;
+    }
+
+    /** This CPU's data caches, from sysfs, so the cliffs can be lined up with
+        them. Empty where sysfs isn't available.
+    */
+    juce::Array<juce::var> describeCaches()
+    {
+        juce::Array<juce::var> caches;
+        const juce::File cacheDirectory("/sys/devices/system/cpu/cpu0/cache");
+
+        for (const auto& index : cacheDirectory.findChildFiles(juce::File::findDirectories, false, "index*"))
+        {
+            const auto type = index.getChildFile("type").loadFileAsString().trim();
+
+            if (type == "Instruction")
+                continue;
+
+            auto* cache = new juce::DynamicObject();
+            cache->setProperty("level", index.getChildFile("level").loadFileAsString().trim().getIntValue());
+            cache->setProperty("type", type);
+            cache->setProperty("size", index.getChildFile("size").loadFileAsString().trim());
+            caches.add(cache);
+        }
+
+        return caches;
+    }
+
+    juce::var toJson(const Stage& stage, const Config& config, const Result& result)
+    {
+        auto* object = new juce::DynamicObject();
+        object->setProperty("stage", stage.name);
+        object->setProperty("sampleRate", config.sampleRate);
+        object->setProperty("blockSize", config.blockSize);
+        object->setProperty("layout", config.layout.name);
+        object->setProperty("nsPerSample", result.mean);
+        object->setProperty("nsPerSampleMin", result.min);
+        object->setProperty("nsPerSampleStdDev", std::sqrt(result.variance));
+        object->setProperty("nsPerSampleVariance", result.variance);
+        object->setProperty("realtimePercent", 100.0 * result.mean * config.sampleRate / 1.0e9);
+
+        if (! result.blockLoad.isVoid())
+            object->setProperty("blockLoad", result.blockLoad);
+
+        if (! result.counters.isVoid())
+            object->setProperty("counters", result.counters);
+
+        return object;
+    }
+
+    Options parseOptions(const juce::StringArray& args)
+    {
+        Options options;
+
+        for (int i = 0; i < args.size(); ++i)
+        {
+            const auto& arg = args[i];
+            const auto next = [&] { return args[juce::jmin(++i, args.size() - 1)]; };
+
+            if (arg == "--quick")        options.quick = true;
+            else if (arg == "--runs")    options.runs = juce::jmax(1, next().getIntValue());
+            else if (arg == "--seconds") options.seconds = juce::jmax(0.001, next().getDoubleValue());
+            else if (arg == "--stage")   options.stage = next();
+            else if (arg == "--counters") options.counters = true;
+            else if (arg == "--output")  options.output = juce::File::getCurrentWorkingDirectory().getChildFile(next());
+            else if (arg == "--sample-rate") options.sampleRate = juce::jmax(8000.0, next().getDoubleValue());
+            else if (arg == "--block-size")  options.blockSize = juce::jmax(1, next().getIntValue());
+            else if (arg == "--engines") options.engines = true;
+            else if (arg == "--split")   options.split = true;
+            else if (arg == "--instances")
+                options.maxInstances = i + 1 < args.size() && args[i + 1].containsOnly("0123456789") ? juce::jmax(1, next().getIntValue()) : 512;
+            else std::fprintf(stderr, "ignoring unknown argument %s\n", arg.toRawUTF8());
+        }
+
+        return options;
+    }
+}
+
+/** Writes the report to the output file, or stdout. Returns the exit code. */
+static int writeReport(juce::DynamicObject* report, const Options& options)
+{
+    const auto json = juce::JSON::toString(juce::var(report));
+
+    if (options.output == juce::File())
+        std::printf("%s\n", json.toRawUTF8());
+    else if (! options.output.replaceWithText(json))
+        return 1;
+
+    return 0;
+}
+
+int main(int argc, char* argv[])
+{
+    juce::ScopedJuceInitialiser_GUI juceInitialiser;
+
+    juce::StringArray args;
+
+    for (int i = 1; i < argc; ++i)
+        args.add(argv[i]);
+
+    const auto options = parseOptions(args);
+
+    auto* report = new juce::DynamicObject();
+    report->setProperty("benchmark", "YetiReverbBench");
+    report->setProperty("kernels", DspKernels::get().name);
+
+    if (options.counters)
+    {
+        const PerfCounters probe;
+        report->setProperty("counters", probe.isAvailable());
+
+        if (! probe.isAvailable())
+        {
+            std::fprintf(stderr, "hardware counters unavailable (%s)\n", probe.getError().toRawUTF8());
+            report->setProperty("countersError", probe.getError());
+        }
+    }
+
+    if (options.engines)
+    {
+        report->setProperty("mode", "engines");
+        report->setProperty("sampleRate", options.sampleRate);
+        report->setProperty("blockSize", options.blockSize);
+        report->setProperty("runs", options.runs);
+        report->setProperty("secondsPerRun", options.seconds);
+        report->setProperty("results", compareEngines(options));
+        return writeReport(report, options);
+    }
+
+    if (options.split)
+    {
+        report->setProperty("mode", "split");
+        report->setProperty("sampleRate", options.sampleRate);
+        report->setProperty("runs", options.runs);
+        report->setProperty("secondsPerRun", options.seconds);
+        report->setProperty("results", measureSplit(options));
+        return writeReport(report, options);
+    }
+
+    if (options.maxInstances > 0)
+    {
+        juce::Array<juce::var> results;
+
+        for (int numInstances = 1; numInstances <= options.maxInstances; numInstances *= 2)
+            results.add(measureInstances(numInstances, options));
+
+        report->setProperty("mode", "instances");
+        report->setProperty("caches", describeCaches());
+        report->setProperty("results", results);
+        return writeReport(report, options);
+    }
+
+    const std::vector<double> sampleRates = options.quick ? std::vector<double> { 48000.0, 192000.0 }
+                                                          : std::vector<double> { 44100.0, 48000.0, 88200.0, 96000.0, 176400.0, 192000.0 };
+    const std::vector<int> blockSizes = options.quick ? std::vector<int> { 1, 64, 512, 8192 }
+                                                      : std::vector<int> { 1, 16, 64, 256, 512, 1024, 4096, 8192 };
+    const Layout layouts[] = { { "mono", 1, 0 }, { "stereo", 2, 0 }, { "stereo+send", 2, 2 } };
+
+    juce::Array<juce::var> results;
+
+    for (const auto& stage : stages)
+    {
+        if (options.stage.isNotEmpty() && options.stage != stage.name)
+            continue;
+
+        for (const auto& layout : layouts)
+        {
+            if (layout.sendChannels > 0 && ! stage.runsWithSends)
+                continue;
+
+            for (const auto sampleRate : sampleRates)
+            {
+                for (const auto blockSize : blockSizes)
+                {
+                    const Config config { sampleRate, blockSize, layout };
+                    const auto result = stage.run(config, options);
+
+                    std::fprintf(stderr, "%-18s %-12s %8.0f Hz %5d  %10.2f ns/sample  %8.3f%% RT\n",
+                                 stage.name, layout.name, sampleRate, blockSize,
+                                 result.mean, 100.0 * result.mean * sampleRate / 1.0e9);
+
+                    results.add(toJson(stage, config, result));
+                }
+            }
+        }
+    }
+
+    report->setProperty("mode", "stages");
+    report->setProperty("runs", options.runs);
+    report->setProperty("secondsPerRun", options.seconds);
+    report->setProperty("results", results);
+    return writeReport(report, options);
+}
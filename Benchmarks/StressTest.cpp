@@ -0,0 +1,685 @@
+/*
+  ==============================================================================
+
+    Drives the processor the way real hosts do when they're being awkward,
+    for as long as it's asked to, and fails if it ever produces a NaN, an
+    infinity, a runaway level or a denormal, or slows down as its tail decays
+    towards the denormal range.
+
+    The run is a series of episodes, each picked at random from its own seed.
+    An episode may change the bus layout, sample rate and announced block
+    size, and call prepareToPlay once or twice, the first time with a
+    different size. Then it streams a few seconds of one kind of signal in
+    blocks that can be the announced size, smaller and uneven, empty, or up
+    to four times larger than announced. Parameters are automated between
+    blocks and bypass is toggled, as on the audio thread. Meanwhile a second
+    thread sets the processor's state and moves parameters, as a host's UI
+    and session loading do. Some of the long tails are offline bounces in
+    blocks big enough for Freeverb to hand the right channel to its render
+    worker.
+
+    Every call is timed. Each block is also measured against its deadline,
+    i.e. how long it lasts at the sample rate, to give the tail latency and
+    the deadline misses. Episodes run as fast as they can rather than paced
+    in real time, so a miss means one block took longer than its own length.
+
+    A failure prints the episode and the run's seed, so it can be replayed on
+    its own with --seed and --episode. The replay repeats the episode's
+    blocks exactly, and the other thread's calls in the same order, but not
+    where those calls land between the blocks, which is down to the threads'
+    timing. A failure that needs a call at one particular moment may take a
+    few replays to show again.
+
+    Usage: YetiStressTest [--minutes M] [--seed N] [--episode N]
+                          [--max-deadline-misses N] [--output FILE]
+
+  ==============================================================================
+*/
+
+#include <JuceHeader.h>
+#include "PluginProcessor.h"
+#include "LoadStatisticsJson.h"
+
+namespace
+{
+    struct Options
+    {
+        double minutes = 1.0;
+        juce::int64 seed = 1;
+        int episode = -1;                   // only run this episode, if set
+        juce::int64 maxDeadlineMisses = -1; // fail if there are more, if set
+        juce::File output;                  // stdout if not set
+    };
+
+    enum class Signal
+    {
+        noise,
+        sine,
+        impulses,
+        fullScaleSquare,
+        dcOffset,
+        denormals,
+        numSignals
+    };
+
+    const char* getName(Signal signal)
+    {
+        static constexpr const char* names[] = { "noise", "sine", "impulses", "fullScaleSquare", "dcOffset", "denormals" };
+        return names[(int) signal];
+    }
+
+    enum class BlockSizes
+    {
+        announced,
+        uneven,         // anything up to the announced size, as hosts that split at automation do
+        oversized,      // mostly announced, now and then up to four times larger
+        ragged,         // all of the above, and empty blocks
+        numKinds
+    };
+
+    const char* getName(BlockSizes blockSizes)
+    {
+        static constexpr const char* names[] = { "announced", "uneven", "oversized", "ragged" };
+        return names[(int) blockSizes];
+    }
+
+    // Far above anything the plugin should produce from a full-scale input,
+    // even with both shelves at full boost.
+    constexpr float runawayLevel = 1000.0f;
+
+    // How much slower the end of a long tail may run than the signal before it.
+    constexpr double maxTailSlowdown = 3.0;
+
+    constexpr double sampleRates[] = { 22050.0, 44100.0, 48000.0, 88200.0, 96000.0, 176400.0, 192000.0 };
+    constexpr int blockSizes[] = { 1, 16, 32, 64, 128, 256, 441, 480, 512, 1024, 2048, 4096 };
+
+    /** Spreads neighbouring episodes' seeds apart, since juce::Random's first
+        few numbers from nearby seeds are close to each other.
+    */
+    juce::int64 getEpisodeSeed(juce::int64 seed, int episode)
+    {
+        auto x = (juce::uint64) seed * 0x9e3779b97f4a7c15ull + (juce::uint64) episode;
+        x = (x ^ (x >> 30)) * 0xbf58476d1ce4e5b9ull;
+        x = (x ^ (x >> 27)) * 0x94d049bb133111ebull;
+        return (juce::int64) (x ^ (x >> 31));
+    }
+
+    //==============================================================================
+    /** How many times a call was made and how long it took. */
+    struct CallTimes
+    {
+        juce::int64 count = 0;
+        double totalSeconds = 0.0, worstSeconds = 0.0;
+
+        void add(double seconds) noexcept
+        {
+            ++count;
+            totalSeconds += seconds;
+            worstSeconds = juce::jmax(worstSeconds, seconds);
+        }
+
+        CallTimes& operator+= (const CallTimes& other) noexcept
+        {
+            count += other.count;
+            totalSeconds += other.totalSeconds;
+            worstSeconds = juce::jmax(worstSeconds, other.worstSeconds);
+            return *this;
+        }
+
+        juce::var toJson() const
+        {
+            auto* object = new juce::DynamicObject();
+            object->setProperty("count", count);
+            object->setProperty("meanMicroseconds", count > 0 ? totalSeconds * 1.0e6 / (double) count : 0.0);
+            object->setProperty("worstMicroseconds", worstSeconds * 1.0e6);
+            return object;
+        }
+    };
+
+    using CallLog = std::map<juce::String, CallTimes>;
+
+    template <typename Call>
+    void timeCall(CallLog& log, const juce::String& name, Call&& call)
+    {
+        const auto start = juce::Time::getHighResolutionTicks();
+        call();
+        log[name].add(juce::Time::highResolutionTicksToSeconds(juce::Time::getHighResolutionTicks() - start));
+    }
+
+    struct Failure
+    {
+        int episode;
+        juce::int64 block;
+        juce::String kind, detail;
+    };
+
+    //==============================================================================
+    /** The host's other thread: loads a state or moves a parameter every few
+        milliseconds while it's enabled. Nothing runs the message loop, so it
+        stands in for the message thread, which setStateInformation needs.
+        Its choices follow the seed it was last given, so an episode replays
+        the same ones, but they land between the episode's blocks wherever the
+        two threads' timing puts them.
+    */
+    class MessageThread : public juce::Thread
+    {
+    public:
+        MessageThread(YetiReverbAudioProcessor& processorToUse, std::vector<juce::MemoryBlock> statesToLoad)
+            : juce::Thread("Yeti stress host"), processor(processorToUse), states(std::move(statesToLoad))
+        {
+        }
+
+        /** Starts the choices over from the seed, as the next episode begins. */
+        void setSeed(juce::int64 newSeed) noexcept
+        {
+            seed = newSeed;
+            ++seedChanges;
+        }
+
+        void run() override
+        {
+            juce::Random random;
+            const auto& parameters = processor.getParameters();
+            int seedsSeen = 0;
+
+            while (! threadShouldExit())
+            {
+                if (const auto changes = seedChanges.load(); changes != seedsSeen)
+                {
+                    random.setSeed(seed.load());
+                    seedsSeen = changes;
+                }
+
+                wait(random.nextInt({ 2, 60 }));
+
+                if (! enabled)
+                    continue;
+
+                if (random.nextInt(3) == 0)
+                {
+                    const auto& state = states[(size_t) random.nextInt((int) states.size())];
+
+                    timeCall(log, "setStateInformation", [&]
+                    {
+                        processor.setStateInformation(state.getData(), (int) state.getSize());
+                    });
+                }
+                else
+                {
+                    auto* parameter = parameters[random.nextInt(parameters.size())];
+                    timeCall(log, "setValueNotifyingHost", [&] { parameter->setValueNotifyingHost(random.nextFloat()); });
+                }
+            }
+        }
+
+        std::atomic<bool> enabled { true };
+
+        /** Only read once the thread has stopped. */
+        CallLog log;
+
+    private:
+        YetiReverbAudioProcessor& processor;
+        std::vector<juce::MemoryBlock> states;
+        std::atomic<juce::int64> seed { 0 };
+        std::atomic<int> seedChanges { 0 };
+    };
+
+    //==============================================================================
+    class StressTest
+    {
+    public:
+        explicit StressTest(const Options& optionsToUse) : options(optionsToUse) {}
+
+        void run()
+        {
+            // A few states to load from the other thread, each with every
+            // parameter somewhere random.
+            std::vector<juce::MemoryBlock> states;
+            juce::Random random(options.seed);
+
+            for (int i = 0; i < 8; ++i)
+            {
+                randomiseParameters(random);
+                states.emplace_back();
+                timeCall(calls, "getStateInformation", [&] { processor.getStateInformation(states.back()); });
+            }
+
+            MessageThread messageThread(processor, std::move(states));
+            messageThread.startThread();
+
+            const auto start = juce::Time::getMillisecondCounterHiRes();
+            const auto end = start + options.minutes * 60.0 * 1000.0;
+            auto nextProgress = start + 10000.0;
+
+            for (int episode = 0;; ++episode)
+            {
+                if (options.episode >= 0)
+                    episode = options.episode;
+
+                runEpisode(episode, messageThread);
+                ++numEpisodes;
+
+                const auto now = juce::Time::getMillisecondCounterHiRes();
+
+                if (options.episode >= 0 || now >= end)
+                    break;
+
+                if (now >= nextProgress)
+                {
+                    std::fprintf(stderr, "%6.0f s  %6d episodes  %8.0f s of audio  p99.9 %6.2f%%  %lld missed  %d failures\n",
+                                 (now - start) / 1000.0, numEpisodes, audioSeconds, 100.0 * blockLoad.getPercentile(0.999),
+                                 (long long) blockLoad.overDeadline, (int) failures.size());
+                    nextProgress = now + 10000.0;
+                }
+            }
+
+            messageThread.stopThread(2000);
+
+            for (const auto& [name, times] : messageThread.log)
+                calls[name + " (other thread)"] += times;
+
+            wallSeconds = (juce::Time::getMillisecondCounterHiRes() - start) / 1000.0;
+        }
+
+        bool passed() const
+        {
+            return failures.empty()
+                && (options.maxDeadlineMisses < 0 || (juce::int64) blockLoad.overDeadline <= options.maxDeadlineMisses);
+        }
+
+        juce::var toJson() const
+        {
+            auto* callTimes = new juce::DynamicObject();
+
+            for (const auto& [name, times] : calls)
+                callTimes->setProperty(name, times.toJson());
+
+            juce::Array<juce::var> failureList;
+
+            for (const auto& failure : failures)
+            {
+                auto* object = new juce::DynamicObject();
+                object->setProperty("episode", failure.episode);
+                object->setProperty("block", failure.block);
+                object->setProperty("kind", failure.kind);
+                object->setProperty("detail", failure.detail);
+                failureList.add(object);
+            }
+
+            auto* report = new juce::DynamicObject();
+            report->setProperty("benchmark", "YetiStressTest");
+            report->setProperty("kernels", DspKernels::get().name);
+            report->setProperty("seed", options.seed);
+            report->setProperty("episodes", numEpisodes);
+            report->setProperty("wallSeconds", wallSeconds);
+            report->setProperty("audioSeconds", audioSeconds);
+            report->setProperty("blockLoad", ::toJson(blockLoad));
+            report->setProperty("calls", callTimes);
+            report->setProperty("failures", failureList);
+            report->setProperty("passed", passed());
+            return report;
+        }
+
+    private:
+        void randomiseParameters(juce::Random& random)
+        {
+            for (auto* parameter : processor.getParameters())
+                parameter->setValueNotifyingHost(random.nextFloat());
+        }
+
+        /** Some hosts only ever give a plugin stereo. Others change the layout
+            between sessions, or when a track's sends are routed.
+        */
+        juce::AudioProcessor::BusesLayout pickLayout(juce::Random& random) const
+        {
+            const auto mainSet = random.nextBool() ? juce::AudioChannelSet::stereo() : juce::AudioChannelSet::mono();
+            auto layout = processor.getBusesLayout();
+            layout.inputBuses.getReference(0) = mainSet;
+            layout.outputBuses.getReference(0) = mainSet;
+
+            for (int bus = 1; bus < layout.inputBuses.size(); ++bus)
+            {
+                const auto pick = random.nextInt(6);
+                layout.inputBuses.getReference(bus) = pick == 0 ? juce::AudioChannelSet::stereo()
+                                                    : pick == 1 ? juce::AudioChannelSet::mono()
+                                                                : juce::AudioChannelSet::disabled();
+            }
+
+            return layout;
+        }
+
+        int pickBlockSize(juce::Random& random, BlockSizes kind, int announced) const
+        {
+            switch (kind)
+            {
+                case BlockSizes::uneven:
+                    return random.nextInt({ 1, announced + 1 });
+
+                case BlockSizes::oversized:
+                    return random.nextInt(20) == 0 ? announced * random.nextInt({ 2, 5 }) : announced;
+
+                case BlockSizes::ragged:
+                {
+                    const auto pick = random.nextInt(20);
+                    return pick == 0 ? 0
+                         : pick == 1 ? announced * random.nextInt({ 2, 5 })
+                         : pick < 8  ? random.nextInt({ 1, announced + 1 })
+                                     : announced;
+                }
+
+                case BlockSizes::announced:
+                case BlockSizes::numKinds:
+                default:
+                    return announced;
+            }
+        }
+
+        void fill(juce::AudioBuffer<float>& buffer, int numSamples, Signal signal, juce::Random& random, juce::int64& position) const
+        {
+            for (int channel = 0; channel < buffer.getNumChannels(); ++channel)
+            {
+                auto* data = buffer.getWritePointer(channel);
+
+                for (int i = 0; i < numSamples; ++i)
+                {
+                    const auto n = position + i;
+
+                    switch (signal)
+                    {
+                        case Signal::noise:           data[i] = (random.nextFloat() * 2.0f - 1.0f) * 0.5f; break;
+                        case Signal::sine:            data[i] = 0.7f * std::sin((float) n * 0.031f * (float) (channel + 1)); break;
+                        case Signal::impulses:        data[i] = n % 9973 == 0 ? 1.0f : 0.0f; break;
+                        case Signal::fullScaleSquare: data[i] = (n / 50) % 2 == 0 ? 1.0f : -1.0f; break;
+                        case Signal::dcOffset:        data[i] = 0.9f; break;
+                        case Signal::denormals:       data[i] = (n % 2 == 0 ? 1.0f : -1.0f) * std::numeric_limits<float>::denorm_min() * 1000.0f; break;
+                        case Signal::numSignals:
+                        default:                      data[i] = 0.0f; break;
+                    }
+                }
+            }
+
+            position += numSamples;
+        }
+
+        /** Looks for anything a host must never be given, and returns what it
+            found, if anything.
+        */
+        juce::String checkOutput(const juce::AudioBuffer<float>& buffer, int numSamples, bool denormalsAllowed) const
+        {
+            for (int channel = 0; channel < processor.getTotalNumOutputChannels(); ++channel)
+            {
+                const auto* data = buffer.getReadPointer(channel);
+
+                for (int i = 0; i < numSamples; ++i)
+                {
+                    const auto sample = data[i];
+                    const auto where = " at channel " + juce::String(channel) + ", sample " + juce::String(i);
+
+                    if (std::isnan(sample))
+                        return "NaN" + where;
+
+                    if (std::isinf(sample))
+                        return "infinity" + where;
+
+                    if (std::abs(sample) > runawayLevel)
+                        return "runaway level " + juce::String(sample) + where;
+
+                    if (! denormalsAllowed && std::fpclassify(sample) == FP_SUBNORMAL)
+                        return "denormal " + juce::String(sample) + where;
+                }
+            }
+
+            return {};
+        }
+
+        void fail(int episode, juce::int64 block, const juce::String& kind, const juce::String& detail,
+                  const juce::StringArray& actions)
+        {
+            failures.push_back({ episode, block, kind, detail + " after " + actions.joinIntoString(", ") });
+
+            std::fprintf(stderr, "FAILED: %s in episode %d (replay with --seed %lld --episode %d), block %lld: %s\n    %s\n",
+                         kind.toRawUTF8(), episode, (long long) options.seed, episode, (long long) block,
+                         detail.toRawUTF8(), actions.joinIntoString(", ").toRawUTF8());
+        }
+
+        //==============================================================================
+        void runEpisode(int episode, MessageThread& messageThread)
+        {
+            juce::Random random(getEpisodeSeed(options.seed, episode));
+            juce::StringArray actions;
+
+            const auto sampleRate = sampleRates[random.nextInt((int) std::size(sampleRates))];
+            const auto signal = (Signal) random.nextInt((int) Signal::numSignals);
+
+            // A long silence after the signal, for the reverb to decay towards
+            // the denormal range. The other thread and the automation would
+            // change what the tail costs, so they stay quiet for it.
+            const auto longTail = random.nextInt(4) == 0;
+
+            // A third of the long tails are offline bounces through Freeverb in
+            // stereo blocks big enough for the render worker to take the right
+            // channel, so a tail decaying on the worker thread is timed too.
+            const auto bounce = longTail && random.nextInt(3) == 0;
+
+            const auto announced = bounce ? FreeverbNetwork<>::minSplitBlockSize * (1 << random.nextInt(2))
+                                          : blockSizes[random.nextInt((int) std::size(blockSizes))];
+            const auto nonRealtime = bounce || random.nextInt(10) == 0;
+            const auto sizes = bounce ? BlockSizes::announced : (BlockSizes) random.nextInt((int) BlockSizes::numKinds);
+            const auto automate = ! longTail && random.nextInt(4) == 0;
+            const auto signalSeconds = (bounce ? 4.0 : 0.5) + random.nextDouble() * 3.5;
+            const auto tailSeconds = longTail ? 20.0 + random.nextDouble() * 10.0 : random.nextDouble();
+
+            messageThread.setSeed(getEpisodeSeed(~options.seed, episode));
+            messageThread.enabled = ! longTail;
+
+            if (random.nextInt(3) == 0)
+            {
+                timeCall(calls, "releaseResources", [&] { processor.releaseResources(); });
+                actions.add("releaseResources");
+            }
+
+            if (random.nextInt(4) == 0 || episode == 0 || bounce)
+            {
+                auto layout = pickLayout(random);
+
+                if (bounce)
+                {
+                    layout.inputBuses.getReference(0) = juce::AudioChannelSet::stereo();
+                    layout.outputBuses.getReference(0) = juce::AudioChannelSet::stereo();
+                }
+
+                timeCall(calls, "setBusesLayout", [&] { processor.setBusesLayout(layout); });
+                actions.add("layout " + juce::String(processor.getTotalNumInputChannels()) + " in, "
+                            + juce::String(processor.getTotalNumOutputChannels()) + " out");
+            }
+
+            randomiseParameters(random);
+
+            if (longTail)
+            {
+                // Only the engine and the room; bypass would stop the tail.
+                processor.apvts.getParameter(ParamIDs::bypass)->setValueNotifyingHost(0.0f);
+                processor.apvts.getParameter(ParamIDs::adaptiveQuality)->setValueNotifyingHost(0.0f);
+            }
+
+            if (bounce)
+            {
+                // The shimmer feeds both channels back into both, so the network
+                // only splits while it's off.
+                processor.apvts.getParameter(ParamIDs::algorithm)->setValueNotifyingHost(0.0f);
+                processor.apvts.getParameter(ParamIDs::multiband)->setValueNotifyingHost(0.0f);
+                processor.apvts.getParameter(ParamIDs::shimmer)->setValueNotifyingHost(0.0f);
+            }
+
+            processor.setNonRealtime(nonRealtime);
+
+            const auto prepare = [&](int blockSize)
+            {
+                processor.setRateAndBufferSizeDetails(sampleRate, blockSize);
+                timeCall(calls, "prepareToPlay", [&] { processor.prepareToPlay(sampleRate, blockSize); });
+                actions.add("prepareToPlay " + juce::String(blockSize));
+            };
+
+            // Some hosts prepare twice, the first time with another size.
+            if (random.nextInt(3) == 0)
+                prepare(blockSizes[random.nextInt((int) std::size(blockSizes))]);
+
+            prepare(announced);
+
+            actions.add(juce::String(sampleRate, 0) + " Hz");
+            actions.add(juce::String(getName(sizes)) + " blocks");
+            actions.add(juce::String(getName(signal)) + (longTail ? " then a long tail" : ""));
+
+            if (bounce)
+                actions.add("offline bounce");
+            else if (nonRealtime)
+                actions.add("offline");
+
+            if (automate)
+                actions.add("automation");
+
+            const auto numChannels = juce::jmax(processor.getTotalNumInputChannels(), processor.getTotalNumOutputChannels());
+            juce::AudioBuffer<float> buffer(numChannels, announced * 4);
+            juce::MidiBuffer midi;
+
+            const auto signalSamples = (juce::int64) (signalSeconds * sampleRate);
+            const auto totalSamples = signalSamples + (juce::int64) (tailSeconds * sampleRate);
+            const auto& parameters = processor.getParameters();
+            auto* bypass = processor.apvts.getParameter(ParamIDs::bypass);
+
+            // The cost per sample in the second half of the signal and at the
+            // end of a long tail. A bounce's blocks are large, so it measures
+            // over longer stretches and settles for fewer of them.
+            std::vector<double> signalCosts, tailCosts;
+            const auto tailStart = totalSamples - (juce::int64) ((bounce ? 4.0 : 2.0) * sampleRate);
+            const auto minCosts = bounce ? (size_t) 10 : (size_t) 20;
+
+            juce::int64 position = 0;
+
+            for (juce::int64 block = 0; position < totalSamples; ++block)
+            {
+                const auto numSamples = (int) juce::jmin((juce::int64) pickBlockSize(random, sizes, announced), totalSamples - position);
+                const auto inSignal = position < signalSamples;
+                const auto blockStart = position;
+
+                if (inSignal)
+                {
+                    fill(buffer, numSamples, signal, random, position);
+                }
+                else
+                {
+                    buffer.clear();
+                    position += juce::jmax(1, numSamples);
+                }
+
+                if (automate)
+                {
+                    parameters[random.nextInt(parameters.size())]->setValue(random.nextFloat());
+
+                    if (random.nextInt(200) == 0)
+                        bypass->setValue(bypass->getValue() < 0.5f ? 1.0f : 0.0f);
+                }
+
+                juce::AudioBuffer<float> view(buffer.getArrayOfWritePointers(), numChannels, numSamples);
+
+                const auto start = juce::Time::getHighResolutionTicks();
+                processor.processBlock(view, midi);
+                const auto seconds = juce::Time::highResolutionTicksToSeconds(juce::Time::getHighResolutionTicks() - start);
+
+                calls["processBlock"].add(seconds);
+
+                // Offline blocks have no deadline, but a bounce's tail still
+                // shouldn't slow down.
+                if (numSamples > 0 && ! nonRealtime)
+                    blockLoad.add((float) (seconds * sampleRate / numSamples));
+
+                if (numSamples > 0 && (! nonRealtime || bounce))
+                {
+                    if (blockStart > signalSamples / 2 && inSignal)
+                        signalCosts.push_back(seconds / numSamples);
+                    else if (longTail && blockStart > tailStart)
+                        tailCosts.push_back(seconds / numSamples);
+                }
+
+                if (const auto problem = checkOutput(view, numSamples, signal == Signal::denormals); problem.isNotEmpty())
+                {
+                    fail(episode, block, "bad output", problem, actions);
+                    break;
+                }
+            }
+
+            audioSeconds += (double) position / sampleRate;
+
+            // Medians, since the odd preempted block says nothing about denormals.
+            const auto median = [](std::vector<double>& costs)
+            {
+                std::nth_element(costs.begin(), costs.begin() + (ptrdiff_t) (costs.size() / 2), costs.end());
+                return costs[costs.size() / 2];
+            };
+
+            if (longTail && signalCosts.size() >= minCosts && tailCosts.size() >= minCosts)
+            {
+                const auto slowdown = median(tailCosts) / median(signalCosts);
+
+                if (slowdown > maxTailSlowdown)
+                    fail(episode, -1, "denormal slowdown",
+                         "the end of the tail ran " + juce::String(slowdown, 1) + " times slower than the signal", actions);
+            }
+
+            processor.setNonRealtime(false);
+        }
+
+        const Options options;
+        YetiReverbAudioProcessor processor;
+
+        CallLog calls;
+        LoadStatistics blockLoad;
+        std::vector<Failure> failures;
+        int numEpisodes = 0;
+        double audioSeconds = 0.0, wallSeconds = 0.0;
+    };
+
+    Options parseOptions(const juce::StringArray& args)
+    {
+        Options options;
+
+        for (int i = 0; i < args.size(); ++i)
+        {
+            const auto& arg = args[i];
+            const auto next = [&] { return args[juce::jmin(++i, args.size() - 1)]; };
+
+            if (arg == "--minutes")      options.minutes = juce::jmax(0.0, next().getDoubleValue());
+            else if (arg == "--seed")    options.seed = next().getLargeIntValue();
+            else if (arg == "--episode") options.episode = juce::jmax(0, next().getIntValue());
+            else if (arg == "--max-deadline-misses") options.maxDeadlineMisses = juce::jmax(0, next().getIntValue());
+            else if (arg == "--output")  options.output = juce::File::getCurrentWorkingDirectory().getChildFile(next());
+            else std::fprintf(stderr, "ignoring unknown argument %s\n", arg.toRawUTF8());
+        }
+
+        return options;
+    }
+}
+
+int main(int argc, char* argv[])
+{
+    juce::ScopedJuceInitialiser_GUI juceInitialiser;
+
+    juce::StringArray args;
+
+    for (int i = 1; i < argc; ++i)
+        args.add(argv[i]);
+
+    const auto options = parseOptions(args);
+
+    StressTest test(options);
+    test.run();
+
+    const auto json = juce::JSON::toString(test.toJson());
+
+    if (options.output == juce::File())
+        std::printf("%s\n", json.toRawUTF8());
+    else if (! options.output.replaceWithText(json))
+        return 1;
+
+    return test.passed() ? 0 : 1;
+}
@@ -0,0 +1,192 @@
+/*
+  ==============================================================================
+
+    Compares the cost of the Freeverb network's warmth saturation with
+    antiderivative anti-aliasing against running the whole network oversampled
+    with the curve evaluated directly.
+
+    Then measures how much aliasing the curve leaves on its own: a sine is run
+    through it at several drives, and everything in the spectrum that isn't a
+    harmonic of the sine is counted as aliasing. The anti-aliased curve is
+    compared with the same curve evaluated directly, and with plain tanh.
+
+  ==============================================================================
+*/
+
+#include <JuceHeader.h>
+#include "FreeverbNetwork.h"
+
+namespace
+{
+    constexpr double sampleRate = 48000.0;
+    constexpr int blockSize = 512;
+    constexpr int secondsOfAudio = 4;
+    constexpr int numRuns = 5;
+
+    struct Variant
+    {
+        const char* name;
+        float warmth;
+        int oversamplingOrder; // 0 = none, 1 = 2x, 2 = 4x
+    };
+
+    constexpr int aliasingFftOrder = 16;
+
+    /** Runs a sine through the curve and returns the share of the output's
+        energy that isn't at a harmonic of it, in dB. The sine is a whole number
+        of cycles long and the curve has settled from a full pass before, so
+        there is no leakage and anything off the harmonics has been folded
+        back from above Nyquist.
+    */
+    template <typename Curve>
+    double measureAliasing(double frequency, Curve&& curve)
+    {
+        constexpr int size = 1 << aliasingFftOrder;
+
+        // An odd bin, so no alias can land on a harmonic below Nyquist.
+        const auto bin = juce::roundToInt(frequency / sampleRate * size / 2.0) * 2 + 1;
+
+        std::vector<float> samples((size_t) size * 2);
+
+        for (int pass = 0; pass < 2; ++pass)
+            for (int i = 0; i < size; ++i)
+                samples[(size_t) i] = curve((float) std::sin(juce::MathConstants<double>::twoPi * bin * i / size));
+
+        juce::dsp::FFT fft(aliasingFftOrder);
+        fft.performFrequencyOnlyForwardTransform(samples.data(), true);
+
+        double total = 0.0, aliased = 0.0;
+
+        for (int k = 1; k <= size / 2; ++k)
+        {
+            const auto energy = (double) samples[(size_t) k] * samples[(size_t) k];
+            total += energy;
+
+            if (k % bin != 0)
+                aliased += energy;
+        }
+
+        return 10.0 * std::log10(juce::jmax(aliased, 1.0e-30) / total);
+    }
+
+    void printAliasing()
+    {
+        using Lanes = WarmthCurve::Lanes;
+
+        std::printf("\naliasing, dB of the output's energy off the sine's harmonics\n\n");
+        std::printf("%10s %8s %10s %10s %10s\n", "sine", "peak", "tanh", "direct", "ADAA");
+
+        for (const auto frequency : { 2500.0, 5000.0, 11000.0 })
+        {
+            for (const auto peak : { 0.9f, 2.0f, 4.0f, 8.0f })
+            {
+                const auto tanh = measureAliasing(frequency, [peak](float x) { return std::tanh(x * peak); });
+                const auto direct = measureAliasing(frequency, [peak](float x) { return WarmthCurve::apply(Lanes::expand(x * peak)).get(0); });
+
+                WarmthCurve::State state {};
+                const auto adaa = measureAliasing(frequency, [peak, &state](float x)
+                {
+                    return WarmthCurve::process(Lanes::expand(x), state, Lanes::expand(peak), Lanes::expand(1.0f / peak)).get(0);
+                });
+
+                std::printf("%8.0f Hz %8.1f %10.1f %10.1f %10.1f\n", frequency, peak, tanh, direct, adaa);
+            }
+        }
+    }
+
+    /** Returns the fastest of numRuns passes, in nanoseconds per stereo sample. */
+    double measure(const Variant& variant, const juce::AudioBuffer<float>& input)
+    {
+        const auto factor = 1 << variant.oversamplingOrder;
+
+        FreeverbNetwork<> network;
+        network.prepare({ sampleRate * factor, (juce::uint32) (blockSize * factor), 2 });
+
+        juce::Reverb::Parameters params;
+        params.roomSize = 0.8f;
+        params.wetLevel = 0.5f;
+        network.setParameters(params);
+        network.setWarmth(variant.warmth, variant.oversamplingOrder == 0);
+
+        juce::dsp::Oversampling<float> oversampling(2, (size_t) variant.oversamplingOrder,
+                                                    juce::dsp::Oversampling<float>::filterHalfBandPolyphaseIIR, true);
+        oversampling.initProcessing(blockSize);
+
+        juce::AudioBuffer<float> buffer(2, blockSize);
+        juce::ScopedNoDenormals noDenormals;
+        auto best = std::numeric_limits<double>::max();
+
+        for (int run = 0; run < numRuns; ++run)
+        {
+            network.reset();
+            oversampling.reset();
+
+            const auto start = juce::Time::getHighResolutionTicks();
+
+            for (int pos = 0; pos + blockSize <= input.getNumSamples(); pos += blockSize)
+            {
+                for (int ch = 0; ch < 2; ++ch)
+                    buffer.copyFrom(ch, 0, input, ch, pos, blockSize);
+
+                juce::dsp::AudioBlock<float> block(buffer);
+
+                if (variant.oversamplingOrder == 0)
+                {
+                    network.process(juce::dsp::ProcessContextReplacing<float>(block));
+                }
+                else
+                {
+                    auto upsampled = oversampling.processSamplesUp(block);
+                    network.process(juce::dsp::ProcessContextReplacing<float>(upsampled));
+                    oversampling.processSamplesDown(block);
+                }
+            }
+
+            const auto elapsed = juce::Time::highResolutionTicksToSeconds(juce::Time::getHighResolutionTicks() - start);
+            best = juce::jmin(best, elapsed * 1.0e9 / input.getNumSamples());
+        }
+
+        return best;
+    }
+}
+
+int main()
+{
+    juce::AudioBuffer<float> input(2, (int) sampleRate * secondsOfAudio);
+    juce::Random random(1);
+
+    for (int ch = 0; ch < input.getNumChannels(); ++ch)
+        for (int i = 0; i < input.getNumSamples(); ++i)
+            input.setSample(ch, i, random.nextFloat() * 2.0f - 1.0f);
+
+    const Variant variants[] = {
+        { "clean",                 0.0f, 0 },
+        { "warmth, ADAA 1x",       0.7f, 0 },
+        { "warmth, oversampled 2x", 0.7f, 1 },
+        { "warmth, oversampled 4x", 0.7f, 2 }
+    };
+
+    const auto realtimeNs = 1.0e9 / sampleRate;
+    double adaaCost = 0.0;
+
+    std::printf("kernels: %s\n\n", DspKernels::get().name);
+    std::printf("%-24s %12s %10s %12s\n", "variant", "ns/sample", "% RT", "vs ADAA");
+
+    for (const auto& variant : variants)
+    {
+        const auto ns = measure(variant, input);
+
+        if (variant.warmth > 0.0f && variant.oversamplingOrder == 0)
+            adaaCost = ns;
+
+        std::printf("%-24s %12.2f %9.3f%%", variant.name, ns, 100.0 * ns / realtimeNs);
+
+        if (adaaCost > 0.0)
+            std::printf(" %11.2fx\n", ns / adaaCost);
+        else
+            std::printf(" %12s\n", "-");
+    }
+
+    printAliasing();
+    return 0;
+}
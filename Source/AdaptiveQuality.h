@@ -0,0 +1,106 @@
+#pragma once
+
+#include <JuceHeader.h>
+#include "TieredFreeverb.h"
+
+//==============================================================================
+/**
+    Caps the reverb quality tier based on how long each block takes to process.
+
+    Every block's processing time is compared with its real-time budget. The
+    resulting load is held at its peak and released slowly. When that peak gets
+    near the deadline the cap drops a tier; when there is enough headroom to
+    afford the next tier up, it rises again. Stepping down is allowed every
+    quarter second, but stepping up waits two seconds, so a machine hovering
+    around the threshold doesn't flip back and forth.
+
+    Measurements taken while the reverb is crossfading between tiers are
+    ignored, since both tiers are running then.
+*/
+class AdaptiveQuality
+{
+public:
+    AdaptiveQuality() = default;
+
+    //==============================================================================
+    void prepare(double newSampleRate) noexcept
+    {
+        jassert(newSampleRate > 0);
+        sampleRate = newSampleRate;
+        reset();
+    }
+
+    void reset() noexcept
+    {
+        cap = ReverbQuality::high;
+        peakLoad = 0.0;
+        secondsSinceChange = 0.0;
+    }
+
+    /** Records how long a block of numSamples took to process with the reverb
+        running at the given tier. Pass settling as true while a tier change is
+        still being crossfaded.
+    */
+    void addMeasurement(double seconds, int numSamples, ReverbQuality running, bool settling) noexcept
+    {
+        if (numSamples <= 0)
+            return;
+
+        const auto budget = (double) numSamples / sampleRate;
+        secondsSinceChange += budget;
+
+        if (settling)
+            return;
+
+        peakLoad = juce::jmax(seconds / budget, peakLoad - budget / releaseSeconds);
+
+        const auto level = (int) running;
+
+        if (peakLoad > stepDownLoad && level > (int) ReverbQuality::eco && secondsSinceChange >= stepDownInterval)
+        {
+            setCap(level, level - 1);
+        }
+        else if (level < (int) ReverbQuality::high && (int) cap <= level && secondsSinceChange >= stepUpInterval)
+        {
+            // Assume the whole block scales with the tier's cost, which
+            // overestimates, so the step up never lands straight back on the
+            // threshold.
+            const auto projectedLoad = peakLoad * relativeCost[level + 1] / relativeCost[level];
+
+            if (projectedLoad < stepUpLoad)
+                setCap(level, level + 1);
+        }
+    }
+
+    /** Returns the highest tier that currently fits, but never above requested. */
+    ReverbQuality limit(ReverbQuality requested) const noexcept
+    {
+        return (ReverbQuality) juce::jmin((int) requested, (int) cap);
+    }
+
+    /** The peak load the decisions are based on, as a fraction of the budget. */
+    double getPeakLoad() const noexcept { return peakLoad; }
+
+private:
+    //==============================================================================
+    static constexpr double stepDownLoad = 0.75, stepUpLoad = 0.5;
+    static constexpr double stepDownInterval = 0.25, stepUpInterval = 2.0; // seconds
+    static constexpr double releaseSeconds = 4.0; // to release a peak load of 1
+    static constexpr double relativeCost[] = { 0.55, 1.0, 2.5 }; // Eco, Standard, High
+
+    void setCap(int from, int to) noexcept
+    {
+        cap = (ReverbQuality) to;
+        secondsSinceChange = 0.0;
+
+        // The old peak was measured on the old tier, so rescale it to the new one.
+        peakLoad *= relativeCost[to] / relativeCost[from];
+    }
+
+    double sampleRate = 44100.0;
+    ReverbQuality cap = ReverbQuality::high;
+    double peakLoad = 0.0;
+    double secondsSinceChange = 0.0;
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR(AdaptiveQuality)
+};
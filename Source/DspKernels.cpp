@@ -0,0 +1,165 @@
+#include "DspKernels.h"
+#include <JuceHeader.h>
+
+namespace
+{
+    // Odd, so every variant runs its scalar tail as well as its vector loop.
+    constexpr int testLength = 1031;
+
+    // The FMA variants round differently from the generic one, and the shelf
+    // recurrences carry that forward, so the results only agree to within
+    // this (relative to the signal level of about 1).
+    constexpr float tolerance = 1.0e-5f;
+
+    /** Runs every kernel in the variant over a fixed set of signals and returns
+        all the outputs end to end.
+    */
+    std::vector<float> runKernels(const DspKernels& kernels)
+    {
+        juce::Random random(0x5eed);
+        std::vector<float> signals[5];
+
+        for (auto& signal : signals)
+        {
+            signal.resize(testLength);
+
+            for (auto& sample : signal)
+                sample = random.nextFloat() * 2.0f - 1.0f;
+        }
+
+        const auto& [a, b, c, d, src] = signals;
+        std::vector<float> results;
+
+        const auto append = [&results](const std::vector<float>& output)
+        {
+            results.insert(results.end(), output.begin(), output.end());
+        };
+
+        auto dest = a;
+        kernels.addWithMultiply(dest.data(), src.data(), 0.7f, testLength);
+        append(dest);
+
+        // Offset by odd amounts, so nothing lines up with a vector boundary.
+        dest = a;
+        kernels.addWithRamp(dest.data() + 1, src.data() + 3, 0.2f, 1.3f, testLength - 4);
+        append(dest);
+
+        auto left = a, right = b;
+        kernels.mixStereo(left.data(), right.data(), c.data(), d.data(), 0.9f, 0.2f, testLength);
+        append(left);
+        append(right);
+
+        auto samples = a, delayed = b;
+        kernels.allPass(samples.data(), delayed.data(), testLength);
+        append(samples);
+        append(delayed);
+
+        const auto lowShelf = juce::dsp::IIR::Coefficients<float>::makeLowShelf(44100.0, 300.0, 0.707f, 0.25f);
+        const auto highShelf = juce::dsp::IIR::Coefficients<float>::makeHighShelf(44100.0, 5000.0, 0.707f, 0.25f);
+
+        for (int variant = 0; variant < DspKernels::numOutputChainVariants; ++variant)
+        {
+            for (const auto stereo : { true, false })
+            {
+                OutputChainState state {};
+                state.dryGain = { 0.3f, 1.1f, 0.002f, 400 };
+                std::copy_n(lowShelf->getRawCoefficients(), 5, state.lowShelf.coefficients);
+                std::copy_n(highShelf->getRawCoefficients(), 5, state.highShelf.coefficients);
+
+                left = a;
+                right = b;
+                kernels.outputChain[variant](state, left.data(), stereo ? right.data() : nullptr,
+                                             c.data(), stereo ? d.data() : nullptr, testLength);
+                append(left);
+                append(right);
+                append({ state.dryGain.current,
+                         state.lowShelf.state[0][0], state.lowShelf.state[0][1],
+                         state.lowShelf.state[1][0], state.lowShelf.state[1][1],
+                         state.highShelf.state[0][0], state.highShelf.state[0][1],
+                         state.highShelf.state[1][0], state.highShelf.state[1][1] });
+            }
+        }
+
+        return results;
+    }
+
+    const DspKernels& selectKernels()
+    {
+        const DspKernels* supported[4];
+        const auto numSupported = DspKernels::getSupported(supported, (int) std::size(supported));
+        const auto forced = juce::SystemStats::getEnvironmentVariable("YETI_KERNELS", {});
+
+        const DspKernels* best = &DspKernels::getGeneric();
+
+        for (int i = 1; i < numSupported; ++i)
+        {
+            if (! DspKernels::matchesGeneric(*supported[i]))
+            {
+                // A kernel in this variant is broken. Fix it rather than
+                // relying on it being skipped.
+                jassertfalse;
+                continue;
+            }
+
+            best = supported[i];
+
+            if (forced == best->name)
+                break;
+        }
+
+        if (forced == DspKernels::getGeneric().name)
+            best = &DspKernels::getGeneric();
+
+        return *best;
+    }
+}
+
+//==============================================================================
+const DspKernels& DspKernels::get()
+{
+    static const DspKernels& selected = selectKernels();
+    return selected;
+}
+
+const DspKernels& DspKernels::getGeneric() noexcept
+{
+    return getGenericDspKernels();
+}
+
+int DspKernels::getSupported(const DspKernels** variants, int maxVariants)
+{
+    int numVariants = 0;
+
+    const auto add = [&](const DspKernels& variant)
+    {
+        if (numVariants < maxVariants)
+            variants[numVariants++] = &variant;
+    };
+
+    add(getGenericDspKernels());
+
+   #if YETI_KERNELS_X64
+    if (juce::SystemStats::hasAVX2() && juce::SystemStats::hasFMA3())
+        add(getAVX2DspKernels());
+
+    if (juce::SystemStats::hasAVX512F())
+        add(getAVX512DspKernels());
+   #endif
+
+    return numVariants;
+}
+
+bool DspKernels::matchesGeneric(const DspKernels& variant)
+{
+    const auto expected = runKernels(getGeneric());
+    const auto actual = runKernels(variant);
+
+    if (actual.size() != expected.size())
+        return false;
+
+    for (size_t i = 0; i < expected.size(); ++i)
+        if (! (std::abs(actual[i] - expected[i]) <= tolerance * (1.0f + std::abs(expected[i]))))
+            return false;
+
+    return true;
+}
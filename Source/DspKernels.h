@@ -0,0 +1,126 @@
+#pragma once
+
+// This header is shared with the instruction-set-specific translation units, so
+// it mustn't pull in JUCE or anything else with inline code. See
+// DspKernelsImpl.h for why.
+
+#if defined(__x86_64__) || defined(_M_X64)
+ #define YETI_KERNELS_X64 1
+#else
+ #define YETI_KERNELS_X64 0
+#endif
+
+//==============================================================================
+/** What the output chain carries from one block to the next. See OutputChain. */
+struct OutputChainState
+{
+    struct Shelf
+    {
+        float coefficients[5]; // b0, b1, b2, a1, a2, normalised so a0 = 1
+        float state[2][2];     // two per channel
+    };
+
+    /** A linear ramp that behaves like juce::SmoothedValue. */
+    struct Ramp
+    {
+        float current, target, step;
+        int countdown;
+    };
+
+    Ramp dryGain;
+    Shelf lowShelf, highShelf;
+};
+
+//==============================================================================
+/**
+    The inner loops of the reverb, shelf and mixing stages, compiled once per
+    instruction set.
+
+    The plugin is built as one generic binary, so code elsewhere only ever gets
+    the baseline SIMD width (SSE2 on x86-64, NEON on ARM). These kernels are
+    also compiled for AVX2 + FMA and for AVX-512. get() picks the widest
+    variant the CPU supports the first time it is called, which the processor
+    does at construction, so nothing is decided on the audio thread.
+
+    Every variant is checked against the generic one before it can be picked
+    (see matchesGeneric()). One that doesn't match is skipped. Setting the
+    YETI_KERNELS environment variable to a variant's name forces that variant,
+    as long as it is supported and passes the check.
+*/
+struct DspKernels
+{
+    const char* name;
+
+    //==============================================================================
+    // Mixing
+
+    /** dest[i] += src[i] * gain */
+    void (*addWithMultiply)(float* dest, const float* src, float gain, int numSamples) noexcept;
+
+    /** dest[i] += src[i] * a gain ramped linearly from startGain towards endGain,
+        in the same way as juce::AudioBuffer::addFromWithRamp().
+    */
+    void (*addWithRamp)(float* dest, const float* src, float startGain, float endGain, int numSamples) noexcept;
+
+    /** Writes the stereo mix of a wet signal, with wet1 for each side's own
+        channel and wet2 for the opposite one:
+        left[i] = wetLeft[i] * wet1 + wetRight[i] * wet2, and the mirror image
+        for right.
+    */
+    void (*mixStereo)(float* left, float* right, const float* wetLeft, const float* wetRight,
+                      float wet1, float wet2, int numSamples) noexcept;
+
+    //==============================================================================
+    // Reverb
+
+    /** Runs a stretch of samples through a Freeverb allpass, where delayed
+        points at the stretch of delay line they are read from and written back
+        to. numSamples must not be longer than the delay.
+    */
+    void (*allPass)(float* samples, float* delayed, int numSamples) noexcept;
+
+    //==============================================================================
+    // Output
+
+    /** Which stages an output chain variant runs. See outputChain. */
+    enum OutputChainVariant
+    {
+        wetOnly,      // the shelves
+        steadyDry,    // the dry signal at a fixed gain, then the shelves
+        smoothedDry,  // the dry signal with its gain ramping, then the shelves
+        numOutputChainVariants
+    };
+
+    /** Adds the dry signal back under the reverb, then runs the low and high
+        shelves, all in one pass. Each variant is built at compile time from
+        just the stages it needs. right and dryRight are nullptr for mono, and
+        the wetOnly variant ignores the dry pointers.
+    */
+    void (*outputChain[numOutputChainVariants])(OutputChainState& state, float* left, float* right,
+                                                const float* dryLeft, const float* dryRight, int numSamples) noexcept;
+
+    //==============================================================================
+    /** The best verified variant for this CPU. */
+    static const DspKernels& get();
+
+    /** The baseline variant, which every other one is checked against. */
+    static const DspKernels& getGeneric() noexcept;
+
+    /** The variants that are compiled in and supported by this CPU, generic
+        first and widest last. Returns the number written to variants.
+    */
+    static int getSupported(const DspKernels** variants, int maxVariants);
+
+    /** The self-test. Runs every kernel of the variant on the same test signals
+        as the generic one and returns true if the results agree.
+    */
+    static bool matchesGeneric(const DspKernels& variant);
+};
+
+//==============================================================================
+const DspKernels& getGenericDspKernels() noexcept;
+
+#if YETI_KERNELS_X64
+const DspKernels& getAVX2DspKernels() noexcept;
+const DspKernels& getAVX512DspKernels() noexcept;
+#endif
@@ -0,0 +1,66 @@
+#include "DspKernels.h"
+
+#if YETI_KERNELS_X64
+
+#include <immintrin.h>
+
+// Everything from here to the matching pop is compiled for AVX2 + FMA, whatever
+// the flags for the rest of the plugin. It is only called once DspKernels has
+// checked the CPU supports both.
+#if defined(__clang__)
+ #pragma clang attribute push (__attribute__((target("avx2,fma"))), apply_to = function)
+#elif defined(__GNUC__)
+ #pragma GCC push_options
+ #pragma GCC target("avx2,fma")
+#endif
+
+namespace
+{
+
+struct AVX2Ops
+{
+    using Vector = __m256;
+    static constexpr int width = 8;
+
+    static Vector load(const float* p) noexcept            { return _mm256_loadu_ps(p); }
+    static void store(float* p, Vector v) noexcept         { _mm256_storeu_ps(p, v); }
+    static Vector broadcast(float x) noexcept              { return _mm256_set1_ps(x); }
+    static Vector add(Vector a, Vector b) noexcept         { return _mm256_add_ps(a, b); }
+    static Vector sub(Vector a, Vector b) noexcept         { return _mm256_sub_ps(a, b); }
+    static Vector mul(Vector a, Vector b) noexcept         { return _mm256_mul_ps(a, b); }
+    static Vector mulAdd(Vector a, Vector b, Vector c) noexcept { return _mm256_fmadd_ps(a, b, c); }
+
+    static Vector ramp(float start, float step) noexcept
+    {
+        const auto lanes = _mm256_setr_ps(0.0f, 1.0f, 2.0f, 3.0f, 4.0f, 5.0f, 6.0f, 7.0f);
+        return _mm256_fmadd_ps(lanes, _mm256_set1_ps(step), _mm256_set1_ps(start));
+    }
+
+    static Vector undenormalise(Vector v) noexcept
+    {
+        const auto tiny = _mm256_set1_ps(0.1f);
+        return _mm256_sub_ps(_mm256_add_ps(v, tiny), tiny);
+    }
+
+    // The compiler only adds vzeroupper itself when optimising, and without it
+    // the SSE code the kernel returns to runs with a penalty.
+    static void leave() noexcept                           { _mm256_zeroupper(); }
+};
+
+} // namespace
+
+#include "DspKernelsImpl.h"
+
+#if defined(__clang__)
+ #pragma clang attribute pop
+#elif defined(__GNUC__)
+ #pragma GCC pop_options
+#endif
+
+const DspKernels& getAVX2DspKernels() noexcept
+{
+    static constexpr DspKernels kernels = makeKernels<AVX2Ops>("avx2");
+    return kernels;
+}
+
+#endif
@@ -0,0 +1,104 @@
+#include "DspKernels.h"
+
+#if defined(__ARM_NEON) || defined(_M_ARM64)
+ #define YETI_KERNELS_NEON 1
+#else
+ #define YETI_KERNELS_NEON 0
+#endif
+
+#if YETI_KERNELS_X64
+ #include <emmintrin.h>
+#elif YETI_KERNELS_NEON
+ #include <arm_neon.h>
+#endif
+
+// The baseline variant, built with the same flags as the rest of the plugin.
+
+namespace
+{
+
+#if YETI_KERNELS_X64
+struct GenericOps
+{
+    using Vector = __m128;
+    static constexpr int width = 4;
+
+    static Vector load(const float* p) noexcept            { return _mm_loadu_ps(p); }
+    static void store(float* p, Vector v) noexcept         { _mm_storeu_ps(p, v); }
+    static Vector broadcast(float x) noexcept              { return _mm_set1_ps(x); }
+    static Vector add(Vector a, Vector b) noexcept         { return _mm_add_ps(a, b); }
+    static Vector sub(Vector a, Vector b) noexcept         { return _mm_sub_ps(a, b); }
+    static Vector mul(Vector a, Vector b) noexcept         { return _mm_mul_ps(a, b); }
+    static Vector mulAdd(Vector a, Vector b, Vector c) noexcept { return _mm_add_ps(_mm_mul_ps(a, b), c); }
+
+    static Vector ramp(float start, float step) noexcept
+    {
+        return _mm_add_ps(_mm_set1_ps(start), _mm_mul_ps(_mm_setr_ps(0.0f, 1.0f, 2.0f, 3.0f), _mm_set1_ps(step)));
+    }
+
+    static Vector undenormalise(Vector v) noexcept
+    {
+        const auto tiny = _mm_set1_ps(0.1f);
+        return _mm_sub_ps(_mm_add_ps(v, tiny), tiny);
+    }
+    static void leave() noexcept                           {}
+};
+#elif YETI_KERNELS_NEON
+struct GenericOps
+{
+    using Vector = float32x4_t;
+    static constexpr int width = 4;
+
+    static Vector load(const float* p) noexcept            { return vld1q_f32(p); }
+    static void store(float* p, Vector v) noexcept         { vst1q_f32(p, v); }
+    static Vector broadcast(float x) noexcept              { return vdupq_n_f32(x); }
+    static Vector add(Vector a, Vector b) noexcept         { return vaddq_f32(a, b); }
+    static Vector sub(Vector a, Vector b) noexcept         { return vsubq_f32(a, b); }
+    static Vector mul(Vector a, Vector b) noexcept         { return vmulq_f32(a, b); }
+    static Vector mulAdd(Vector a, Vector b, Vector c) noexcept { return vaddq_f32(vmulq_f32(a, b), c); }
+
+    static Vector ramp(float start, float step) noexcept
+    {
+        static const float lanes[] = { 0.0f, 1.0f, 2.0f, 3.0f };
+        return vaddq_f32(vdupq_n_f32(start), vmulq_f32(vld1q_f32(lanes), vdupq_n_f32(step)));
+    }
+
+    static Vector undenormalise(Vector v) noexcept         { return v; }
+    static void leave() noexcept                           {}
+};
+#else
+struct GenericOps
+{
+    using Vector = float;
+    static constexpr int width = 1;
+
+    static Vector load(const float* p) noexcept            { return *p; }
+    static void store(float* p, Vector v) noexcept         { *p = v; }
+    static Vector broadcast(float x) noexcept              { return x; }
+    static Vector add(Vector a, Vector b) noexcept         { return a + b; }
+    static Vector sub(Vector a, Vector b) noexcept         { return a - b; }
+    static Vector mul(Vector a, Vector b) noexcept         { return a * b; }
+    static Vector mulAdd(Vector a, Vector b, Vector c) noexcept { return a * b + c; }
+    static Vector ramp(float start, float) noexcept        { return start; }
+
+    static Vector undenormalise(Vector v) noexcept
+    {
+       #if defined(__i386__) || defined(_M_IX86)
+        v += 0.1f;
+        v -= 0.1f;
+       #endif
+        return v;
+    }
+    static void leave() noexcept                           {}
+};
+#endif
+
+} // namespace
+
+#include "DspKernelsImpl.h"
+
+const DspKernels& getGenericDspKernels() noexcept
+{
+    static constexpr DspKernels kernels = makeKernels<GenericOps>("generic");
+    return kernels;
+}
@@ -0,0 +1,309 @@
+#pragma once
+
+// The kernel bodies, written once against a small set of vector operations.
+//
+// Each DspKernels*.cpp file defines an Ops struct for its instruction set and
+// then includes this file, so it is compiled once per variant. Everything here
+// goes in an anonymous namespace and nothing with inline linkage is included.
+// Otherwise the linker could fold an AVX copy of some shared inline function
+// into the generic code path, and that would crash on older CPUs.
+//
+// An Ops struct provides:
+//     Vector, width
+//     load(const float*), store(float*, Vector), broadcast(float)
+//     add(a, b), sub(a, b), mul(a, b)
+//     mulAdd(a, b, c)          a * b + c, fused where the instruction set allows
+//     ramp(start, step)        { start, start + step, start + 2 * step, ... }
+//     undenormalise(v)         what JUCE_UNDENORMALISE does on this platform
+//     leave()                  called before returning from a vector loop
+//
+// None of the loads or stores may assume alignment.
+
+namespace
+{
+
+float undenormalise(float x) noexcept
+{
+   #if defined(__i386__) || defined(__x86_64__) || defined(_M_IX86) || defined(_M_X64)
+    x += 0.1f;
+    x -= 0.1f;
+   #endif
+    return x;
+}
+
+template <typename Ops>
+void addWithMultiplyKernel(float* dest, const float* src, float gain, int numSamples) noexcept
+{
+    const auto g = Ops::broadcast(gain);
+    int i = 0;
+
+    for (; i + Ops::width <= numSamples; i += Ops::width)
+        Ops::store(dest + i, Ops::mulAdd(Ops::load(src + i), g, Ops::load(dest + i)));
+
+    for (; i < numSamples; ++i)
+        dest[i] += src[i] * gain;
+
+    Ops::leave();
+}
+
+template <typename Ops>
+void addWithRampKernel(float* dest, const float* src, float startGain, float endGain, int numSamples) noexcept
+{
+    if (numSamples <= 0)
+        return;
+
+    const auto increment = (endGain - startGain) / (float) numSamples;
+    int i = 0;
+
+    // Each vector's ramp starts from the exact gain for its first sample, so
+    // the result doesn't depend on the vector width.
+    for (; i + Ops::width <= numSamples; i += Ops::width)
+    {
+        const auto gain = Ops::ramp(startGain + increment * (float) i, increment);
+        Ops::store(dest + i, Ops::mulAdd(Ops::load(src + i), gain, Ops::load(dest + i)));
+    }
+
+    for (; i < numSamples; ++i)
+        dest[i] += src[i] * (startGain + increment * (float) i);
+
+    Ops::leave();
+}
+
+template <typename Ops>
+void mixStereoKernel(float* left, float* right, const float* wetLeft, const float* wetRight,
+                     float wet1, float wet2, int numSamples) noexcept
+{
+    const auto w1 = Ops::broadcast(wet1);
+    const auto w2 = Ops::broadcast(wet2);
+    int i = 0;
+
+    for (; i + Ops::width <= numSamples; i += Ops::width)
+    {
+        const auto l = Ops::load(wetLeft + i);
+        const auto r = Ops::load(wetRight + i);
+
+        Ops::store(left + i, Ops::mulAdd(r, w2, Ops::mul(l, w1)));
+        Ops::store(right + i, Ops::mulAdd(l, w2, Ops::mul(r, w1)));
+    }
+
+    for (; i < numSamples; ++i)
+    {
+        const auto l = wetLeft[i];
+        const auto r = wetRight[i];
+
+        left[i] = l * wet1 + r * wet2;
+        right[i] = r * wet1 + l * wet2;
+    }
+
+    Ops::leave();
+}
+
+template <typename Ops>
+void allPassKernel(float* samples, float* delayed, int numSamples) noexcept
+{
+    // Every sample read here was written a whole delay ago, and numSamples is
+    // never more than the delay, so the stretch has no dependencies inside it.
+    const auto half = Ops::broadcast(0.5f);
+    int i = 0;
+
+    for (; i + Ops::width <= numSamples; i += Ops::width)
+    {
+        const auto buffered = Ops::load(delayed + i);
+        const auto input = Ops::load(samples + i);
+
+        Ops::store(delayed + i, Ops::undenormalise(Ops::mulAdd(buffered, half, input)));
+        Ops::store(samples + i, Ops::sub(buffered, input));
+    }
+
+    for (; i < numSamples; ++i)
+    {
+        const auto buffered = delayed[i];
+        const auto input = samples[i];
+
+        delayed[i] = undenormalise(input + buffered * 0.5f);
+        samples[i] = buffered - input;
+    }
+
+    Ops::leave();
+}
+
+//==============================================================================
+// The output chain is a compile-time pipeline of per-sample stages, in the
+// spirit of juce::dsp::ProcessorChain. Each stage copies its state into locals
+// when the pipeline is built and writes it back in finish(). Once everything is
+// inlined, the whole chain runs out of registers in a single loop. A variant
+// that doesn't need a stage simply doesn't list it.
+//
+// The shelves are recurrences, so they can't be spread across vector lanes in
+// time. The wider instruction sets bring FMA here. Fusing the stages lets one
+// shelf's work on a sample overlap the other's on the next, rather than each
+// taking its own latency-bound pass over the block.
+
+float snapToZero(float x) noexcept
+{
+   #if defined(__i386__) || defined(__x86_64__) || defined(_M_IX86) || defined(_M_X64)
+    if (! (x < -1.0e-8f || x > 1.0e-8f))
+        return 0.0f;
+   #endif
+    return x;
+}
+
+template <bool smoothed>
+class DryStage
+{
+public:
+    DryStage(OutputChainState& state, const float* left, const float* right) noexcept
+        : ramp(state.dryGain), gain(ramp.current), step(ramp.step), target(ramp.target),
+          countdown(ramp.countdown), leftDry(left), rightDry(right)
+    {
+        if constexpr (! smoothed)
+            gain = target;
+    }
+
+    void processFrame(int i, float& left, float& right) noexcept
+    {
+        const auto g = nextGain();
+        left += leftDry[i] * g;
+        right += rightDry[i] * g;
+    }
+
+    void processSample(int i, float& sample) noexcept
+    {
+        sample += leftDry[i] * nextGain();
+    }
+
+    void finish() noexcept
+    {
+        ramp.current = gain;
+        ramp.countdown = countdown;
+    }
+
+private:
+    float nextGain() noexcept
+    {
+        if constexpr (smoothed)
+        {
+            if (countdown > 0)
+                gain = --countdown > 0 ? gain + step : target;
+        }
+
+        return gain;
+    }
+
+    OutputChainState::Ramp& ramp;
+    float gain, step, target;
+    int countdown;
+    const float* leftDry;
+    const float* rightDry;
+};
+
+/** A transposed direct form II biquad over one or two channels. */
+template <OutputChainState::Shelf OutputChainState::* shelf>
+class ShelfStage
+{
+public:
+    ShelfStage(OutputChainState& state, const float*, const float*) noexcept
+        : filter(state.*shelf),
+          b0(filter.coefficients[0]), b1(filter.coefficients[1]), b2(filter.coefficients[2]),
+          a1(filter.coefficients[3]), a2(filter.coefficients[4]),
+          l1(filter.state[0][0]), l2(filter.state[0][1]), r1(filter.state[1][0]), r2(filter.state[1][1])
+    {
+    }
+
+    void processFrame(int, float& left, float& right) noexcept
+    {
+        const auto inL = left;
+        const auto inR = right;
+        left = inL * b0 + l1;
+        right = inR * b0 + r1;
+
+        l1 = inL * b1 - left * a1 + l2;
+        r1 = inR * b1 - right * a1 + r2;
+        l2 = inL * b2 - left * a2;
+        r2 = inR * b2 - right * a2;
+    }
+
+    void processSample(int, float& sample) noexcept
+    {
+        const auto input = sample;
+        sample = input * b0 + l1;
+
+        l1 = input * b1 - sample * a1 + l2;
+        l2 = input * b2 - sample * a2;
+    }
+
+    void finish() noexcept
+    {
+        filter.state[0][0] = snapToZero(l1);
+        filter.state[0][1] = snapToZero(l2);
+        filter.state[1][0] = snapToZero(r1);
+        filter.state[1][1] = snapToZero(r2);
+    }
+
+private:
+    OutputChainState::Shelf& filter;
+    const float b0, b1, b2, a1, a2;
+    float l1, l2, r1, r2;
+};
+
+using LowShelfStage = ShelfStage<&OutputChainState::lowShelf>;
+using HighShelfStage = ShelfStage<&OutputChainState::highShelf>;
+
+/** Runs each sample through every stage in turn. */
+template <typename... Stages>
+class StagePipeline : private Stages...
+{
+public:
+    StagePipeline(OutputChainState& state, const float* dryLeft, const float* dryRight) noexcept
+        : Stages(state, dryLeft, dryRight)...
+    {
+    }
+
+    void process(float* left, float* right, int numSamples) noexcept
+    {
+        if (right == nullptr)
+        {
+            for (int i = 0; i < numSamples; ++i)
+            {
+                auto sample = left[i];
+                (Stages::processSample(i, sample), ...);
+                left[i] = sample;
+            }
+        }
+        else
+        {
+            for (int i = 0; i < numSamples; ++i)
+            {
+                auto l = left[i];
+                auto r = right[i];
+                (Stages::processFrame(i, l, r), ...);
+                left[i] = l;
+                right[i] = r;
+            }
+        }
+
+        (Stages::finish(), ...);
+    }
+};
+
+template <typename Pipeline>
+void outputChainKernel(OutputChainState& state, float* left, float* right,
+                       const float* dryLeft, const float* dryRight, int numSamples) noexcept
+{
+    Pipeline(state, dryLeft, dryRight).process(left, right, numSamples);
+}
+
+template <typename Ops>
+constexpr DspKernels makeKernels(const char* name) noexcept
+{
+    return { name,
+             addWithMultiplyKernel<Ops>,
+             addWithRampKernel<Ops>,
+             mixStereoKernel<Ops>,
+             allPassKernel<Ops>,
+             { outputChainKernel<StagePipeline<LowShelfStage, HighShelfStage>>,
+               outputChainKernel<StagePipeline<DryStage<false>, LowShelfStage, HighShelfStage>>,
+               outputChainKernel<StagePipeline<DryStage<true>, LowShelfStage, HighShelfStage>> } };
+}
+
+} // namespace
@@ -0,0 +1,303 @@
+#pragma once
+
+#include <JuceHeader.h>
+
+//==============================================================================
+/**
+    How long blocks have taken, as a proportion of their deadlines, counted in
+    fixed buckets.
+
+    The buckets are spaced logarithmically, eight to an octave, from 1/1024 of
+    the deadline to four times it, so every bucket is about 9% wider than the
+    one below. A p99.9 of 3% is then told apart from one of 3.3% as well as 60%
+    from 66%. The first bucket takes everything lighter and the last
+    everything heavier.
+*/
+struct LoadStatistics
+{
+    static constexpr int bucketsPerOctave = 8;
+    static constexpr int lowestOctave = -10, highestOctave = 2;
+    static constexpr int numBuckets = (highestOctave - lowestOctave) * bucketsPerOctave + 2;
+
+    std::array<juce::uint64, numBuckets> buckets {};
+    juce::uint64 numBlocks = 0;
+    juce::uint64 over50 = 0, over80 = 0, overDeadline = 0;   // blocks that took more than that share of their deadline
+    float worst = 0.0f;
+    double sum = 0.0, sumOfSquares = 0.0;       // of every block's load, for the mean and the jitter
+
+    float getMean() const noexcept { return numBlocks > 0 ? (float) (sum / (double) numBlocks) : 0.0f; }
+
+    /** How much the load varies from block to block, as a standard deviation. */
+    float getJitter() const noexcept
+    {
+        if (numBlocks < 2)
+            return 0.0f;
+
+        const auto mean = sum / (double) numBlocks;
+        return (float) std::sqrt(juce::jmax(0.0, sumOfSquares / (double) numBlocks - mean * mean));
+    }
+
+    /** The bucket that a block with the given load is counted in. */
+    static int getBucket(float load) noexcept
+    {
+        if (! (load > 0.0f))
+            return 0;
+
+        const auto index = (int) std::floor(std::log2(load) * (float) bucketsPerOctave) - lowestOctave * bucketsPerOctave + 1;
+        return juce::jlimit(0, numBuckets - 1, index);
+    }
+
+    /** The highest load counted in the bucket. The last one has no upper edge. */
+    static float getBucketUpperEdge(int bucket) noexcept
+    {
+        if (bucket >= numBuckets - 1)
+            return std::numeric_limits<float>::infinity();
+
+        return std::exp2((float) (bucket + lowestOctave * bucketsPerOctave) / (float) bucketsPerOctave);
+    }
+
+    /** The load that the given fraction of blocks stayed under, e.g. 0.999 for
+        p99.9. It is rounded up to a bucket edge, so it never flatters.
+    */
+    float getPercentile(double fraction) const noexcept
+    {
+        if (numBlocks == 0)
+            return 0.0f;
+
+        const auto target = (juce::uint64) std::ceil(fraction * (double) numBlocks);
+        juce::uint64 seen = 0;
+
+        for (int bucket = 0; bucket < numBuckets; ++bucket)
+        {
+            seen += buckets[(size_t) bucket];
+
+            if (seen >= target)
+                return juce::jmin(getBucketUpperEdge(bucket), worst);
+        }
+
+        return worst;
+    }
+
+    /** Counts one block. */
+    void add(float load) noexcept { addTo(*this, load); }
+
+    /** Counts one block into anything with the same fields: this, or
+        DspLoadMeter's atomic copy of them, which has a single writer.
+    */
+    template <typename Statistics>
+    static void addTo(Statistics& statistics, float load) noexcept
+    {
+        increment(statistics.buckets[(size_t) getBucket(load)]);
+        increment(statistics.numBlocks);
+
+        if (load > 0.5f)  increment(statistics.over50);
+        if (load > 0.8f)  increment(statistics.over80);
+        if (load > 1.0f)  increment(statistics.overDeadline);
+
+        raise(statistics.worst, load);
+        accumulate(statistics.sum, load);
+        accumulate(statistics.sumOfSquares, (double) load * load);
+    }
+
+    LoadStatistics& operator+= (const LoadStatistics& other) noexcept
+    {
+        for (size_t bucket = 0; bucket < buckets.size(); ++bucket)
+            buckets[bucket] += other.buckets[bucket];
+
+        numBlocks += other.numBlocks;
+        over50 += other.over50;
+        over80 += other.over80;
+        overDeadline += other.overDeadline;
+        worst = juce::jmax(worst, other.worst);
+        sum += other.sum;
+        sumOfSquares += other.sumOfSquares;
+        return *this;
+    }
+
+private:
+    // Only one thread writes the atomic versions, so they need no read-modify-write.
+    static void increment(juce::uint64& count) noexcept { ++count; }
+    static void raise(float& peak, float value) noexcept { peak = juce::jmax(peak, value); }
+    static void accumulate(double& total, double value) noexcept { total += value; }
+
+    static void increment(std::atomic<juce::uint64>& count) noexcept
+    {
+        count.store(count.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+    }
+
+    static void raise(std::atomic<float>& peak, float value) noexcept
+    {
+        if (value > peak.load(std::memory_order_relaxed))
+            peak.store(value, std::memory_order_relaxed);
+    }
+
+    static void accumulate(std::atomic<double>& total, double value) noexcept
+    {
+        total.store(total.load(std::memory_order_relaxed) + value, std::memory_order_relaxed);
+    }
+};
+
+//==============================================================================
+/**
+    How much of each block's real-time budget processBlock uses, for the editor
+    to show.
+
+    The average comes from juce::AudioProcessLoadMeasurer, which smooths it
+    over the last few blocks. The peak is held and then released over a
+    second, so one slow block stays up long enough to be seen at the editor's
+    refresh rate. Both are atomics, so the message thread reads them without
+    taking a lock.
+
+    Every block is also counted in a LoadStatistics histogram, since the
+    average says little about the rare slow block that causes a dropout. The
+    counters are atomics too, with the audio thread as the only writer.
+*/
+class DspLoadMeter
+{
+public:
+    DspLoadMeter() = default;
+
+    //==============================================================================
+    void prepare(double newSampleRate, int maximumBlockSize)
+    {
+        jassert(newSampleRate > 0);
+        sampleRate = newSampleRate;
+        measurer.reset(sampleRate, maximumBlockSize);
+        heldPeak = 0.0;
+        peakLoad = 0.0f;
+        clearStatistics();
+        resetRequested = false;
+    }
+
+    /** Records that a block of numSamples took the given time to process. */
+    void addBlock(double seconds, int numSamples) noexcept
+    {
+        if (numSamples <= 0)
+            return;
+
+        const auto budget = (double) numSamples / sampleRate;
+        measurer.registerRenderTime(seconds * 1000.0, numSamples);
+
+        const auto load = seconds / budget;
+        heldPeak = juce::jmax(load, heldPeak - budget / releaseSeconds);
+        peakLoad.store((float) heldPeak, std::memory_order_relaxed);
+
+        if (resetRequested.exchange(false, std::memory_order_relaxed))
+            clearStatistics();
+
+        LoadStatistics::addTo(statistics, (float) load);
+    }
+
+    /** Times a block, from construction to destruction. Nothing is recorded
+        if shouldMeasure is false, e.g. for an offline render, which isn't
+        bound by real time.
+    */
+    class ScopedTimer
+    {
+    public:
+        ScopedTimer(DspLoadMeter& meterToUse, int numSamplesInBlock, bool shouldMeasure = true) noexcept
+            : meter(shouldMeasure ? &meterToUse : nullptr), numSamples(numSamplesInBlock),
+              startTicks(shouldMeasure ? juce::Time::getHighResolutionTicks() : 0)
+        {
+        }
+
+        ~ScopedTimer()
+        {
+            stop();
+        }
+
+        /** Records the block now rather than at the end of the scope, and
+            returns how long it took in seconds, or 0 if it isn't measured.
+        */
+        double stop() noexcept
+        {
+            if (meter == nullptr)
+                return 0.0;
+
+            const auto seconds = juce::Time::highResolutionTicksToSeconds(juce::Time::getHighResolutionTicks() - startTicks);
+            meter->addBlock(seconds, numSamples);
+            meter = nullptr;
+            return seconds;
+        }
+
+    private:
+        DspLoadMeter* meter;
+        int numSamples;
+        juce::int64 startTicks;
+
+        JUCE_DECLARE_NON_COPYABLE(ScopedTimer)
+    };
+
+    //==============================================================================
+    /** The smoothed load, from 0 to 1. Safe to call from any thread. */
+    float getAverageLoad() const noexcept { return (float) measurer.getLoadAsProportion(); }
+
+    /** The recent peak load. Above 1 means a block missed its deadline. Safe
+        to call from any thread.
+    */
+    float getPeakLoad() const noexcept { return peakLoad.load(std::memory_order_relaxed); }
+
+    /** The blocks that took longer than real time since prepare(). */
+    int getOverrunCount() const noexcept { return measurer.getXRunCount(); }
+
+    /** Every block's load since prepare() or the last resetStatistics(). Safe
+        to call from any thread, though a block finishing at the same moment
+        may be only partly counted.
+    */
+    LoadStatistics getStatistics() const noexcept
+    {
+        LoadStatistics copy;
+
+        for (size_t bucket = 0; bucket < copy.buckets.size(); ++bucket)
+            copy.buckets[bucket] = statistics.buckets[bucket].load(std::memory_order_relaxed);
+
+        copy.numBlocks = statistics.numBlocks.load(std::memory_order_relaxed);
+        copy.over50 = statistics.over50.load(std::memory_order_relaxed);
+        copy.over80 = statistics.over80.load(std::memory_order_relaxed);
+        copy.overDeadline = statistics.overDeadline.load(std::memory_order_relaxed);
+        copy.worst = statistics.worst.load(std::memory_order_relaxed);
+        copy.sum = statistics.sum.load(std::memory_order_relaxed);
+        copy.sumOfSquares = statistics.sumOfSquares.load(std::memory_order_relaxed);
+        return copy;
+    }
+
+    /** Starts the statistics again from the next block. Safe to call from any
+        thread; the audio thread does the clearing.
+    */
+    void resetStatistics() noexcept { resetRequested = true; }
+
+private:
+    void clearStatistics() noexcept
+    {
+        for (auto& bucket : statistics.buckets)
+            bucket.store(0, std::memory_order_relaxed);
+
+        for (auto* counter : { &statistics.numBlocks, &statistics.over50, &statistics.over80, &statistics.overDeadline })
+            counter->store(0, std::memory_order_relaxed);
+
+        statistics.worst.store(0.0f, std::memory_order_relaxed);
+        statistics.sum.store(0.0, std::memory_order_relaxed);
+        statistics.sumOfSquares.store(0.0, std::memory_order_relaxed);
+    }
+
+    static constexpr double releaseSeconds = 1.0;
+
+    juce::AudioProcessLoadMeasurer measurer;
+    double sampleRate = 44100.0;
+    double heldPeak = 0.0;          // audio thread only
+    std::atomic<float> peakLoad { 0.0f };
+
+    /** LoadStatistics' counters as atomics, written by the audio thread only. */
+    struct AtomicStatistics
+    {
+        std::array<std::atomic<juce::uint64>, LoadStatistics::numBuckets> buckets {};
+        std::atomic<juce::uint64> numBlocks { 0 }, over50 { 0 }, over80 { 0 }, overDeadline { 0 };
+        std::atomic<float> worst { 0.0f };
+        std::atomic<double> sum { 0.0 }, sumOfSquares { 0.0 };
+    };
+
+    AtomicStatistics statistics;
+    std::atomic<bool> resetRequested { false };
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR(DspLoadMeter)
+};
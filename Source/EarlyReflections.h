@@ -0,0 +1,405 @@
+#pragma once
+
+#include <JuceHeader.h>
+#include "DspKernels.h"
+#include "MemoryUsage.h"
+
+class EarlyReflectionsDesigner;
+
+//==============================================================================
+/**
+    A sparse tapped-delay early-reflection stage.
+
+    The mono sum of the input is written into one shared delay line, and each output
+    channel reads 16-64 taps from it. Tap delays and gains come from a shoebox
+    image-source model of the room. The model is evaluated on a shared background
+    thread whenever the room changes, and the finished tap set is handed to the audio
+    thread through a lock-free exchange and crossfaded in.
+
+    Processing is split around the late reverb: pushInput() records the dry input,
+    and addTo() accumulates the reflections onto the reverb's output. Every tap then
+    covers a contiguous span of the delay line, so gather-and-accumulate is one
+    vector multiply-add per tap.
+*/
+class EarlyReflections
+{
+public:
+    static constexpr int minTaps = 16;
+    static constexpr int maxTaps = 64;
+
+    EarlyReflections();
+    ~EarlyReflections();
+
+    //==============================================================================
+    void prepare(const juce::dsp::ProcessSpec& spec)
+    {
+        const juce::ScopedLock sl(designLock);
+
+        sampleRate = spec.sampleRate;
+        const auto maxDelay = (int) std::ceil(maxReflectionSeconds * sampleRate);
+        maxBlockSize = (int) spec.maximumBlockSize;
+
+        buffer.assign((size_t) juce::nextPowerOfTwo(maxDelay + maxBlockSize + 1), 0.0f);
+        mask = (int) buffer.size() - 1;
+        writeIndex = 0;
+
+        // Design the first tap set here so the stage is ready before the first block,
+        // and drop anything still in flight that was designed for the old sample rate.
+        writerSlot = 0;
+        readerSlot = 1;
+        sharedSlot.store(2);
+
+        designTaps(requestedRoom(), sampleRate, maxDelay, tapSets[(size_t) readerSlot]);
+        currentTaps = tapSets[(size_t) readerSlot];
+        designedVersion = requestVersion.load();
+        fadeRemaining = 0;
+
+        level.reset(sampleRate, 0.02);
+    }
+
+    void reset() noexcept
+    {
+        std::fill(buffer.begin(), buffer.end(), 0.0f);
+    }
+
+    void addMemoryUsage(MemoryUsage& usage) const noexcept
+    {
+        usage.delayLines += MemoryUsage::bytesOf(buffer);
+    }
+
+    //==============================================================================
+    /** Requests a new room. Safe to call from the audio thread every block; the taps
+        are only redesigned when something has actually changed.
+    */
+    void setRoom(float size, float damping, int numTaps) noexcept
+    {
+        numTaps = juce::jlimit(minTaps, maxTaps, numTaps);
+
+        if (juce::exactlyEqual(size, roomSize.load(std::memory_order_relaxed))
+            && juce::exactlyEqual(damping, roomDamping.load(std::memory_order_relaxed))
+            && numTaps == roomTaps.load(std::memory_order_relaxed))
+            return;
+
+        roomSize.store(size, std::memory_order_relaxed);
+        roomDamping.store(damping, std::memory_order_relaxed);
+        roomTaps.store(numTaps, std::memory_order_relaxed);
+        requestVersion.fetch_add(1, std::memory_order_release);
+    }
+
+    void setLevel(float newLevel) noexcept { level.setTargetValue(newLevel); }
+
+    bool isActive() const noexcept { return level.isSmoothing() || level.getTargetValue() > 0.0f; }
+
+    //==============================================================================
+    /** Records the dry input. Call before the late reverb overwrites the block. */
+    void pushInput(const juce::dsp::AudioBlock<float>& block) noexcept
+    {
+        const auto numSamples = juce::jmin((int) block.getNumSamples(), maxBlockSize);
+        const auto numChannels = block.getNumChannels();
+        const auto channelGain = 1.0f / (float) numChannels;
+
+        const int firstRun = juce::jmin(numSamples, (int) buffer.size() - writeIndex);
+        blockStart = writeIndex;
+
+        for (int run = 0, offset = 0; run < 2; ++run)
+        {
+            const auto runLength = run == 0 ? firstRun : numSamples - firstRun;
+            auto* dest = buffer.data() + (run == 0 ? writeIndex : 0);
+
+            juce::FloatVectorOperations::multiply(dest, block.getChannelPointer(0) + offset, channelGain, runLength);
+
+            for (size_t ch = 1; ch < numChannels; ++ch)
+                juce::FloatVectorOperations::addWithMultiply(dest, block.getChannelPointer(ch) + offset, channelGain, runLength);
+
+            offset += runLength;
+        }
+
+        writeIndex = (writeIndex + numSamples) & mask;
+    }
+
+    /** Adds the reflections of the last pushed input to the block. */
+    void addTo(juce::dsp::AudioBlock<float>& block) noexcept
+    {
+        const auto numSamples = juce::jmin((int) block.getNumSamples(), maxBlockSize);
+        const auto numChannels = juce::jmin((size_t) numSides, block.getNumChannels());
+
+        collectNewTaps();
+
+        float reflections[chunkSize], previous[chunkSize], gains[chunkSize];
+
+        for (int start = 0; start < numSamples; start += chunkSize)
+        {
+            const int num = juce::jmin(chunkSize, numSamples - start);
+            const int readStart = blockStart + start;
+            const int fadeLength = juce::jmin(num, fadeRemaining);
+
+            for (int i = 0; i < num; ++i)
+                gains[i] = level.getNextValue();
+
+            for (size_t ch = 0; ch < numChannels; ++ch)
+            {
+                accumulateTaps(currentTaps, (int) ch, readStart, reflections, num);
+
+                if (fadeLength > 0)
+                {
+                    accumulateTaps(previousTaps, (int) ch, readStart, previous, fadeLength);
+
+                    for (int i = 0; i < fadeLength; ++i)
+                    {
+                        const auto fadeIn = 1.0f - (float) (fadeRemaining - i) / (float) crossfadeSamples;
+                        reflections[i] = previous[i] + (reflections[i] - previous[i]) * fadeIn;
+                    }
+                }
+
+                juce::FloatVectorOperations::addWithMultiply(block.getChannelPointer(ch) + start, reflections, gains, num);
+            }
+
+            fadeRemaining -= fadeLength;
+        }
+    }
+
+private:
+    friend class EarlyReflectionsDesigner;
+
+    //==============================================================================
+    static constexpr int numSides = 2;
+    static constexpr int chunkSize = 64;
+    static constexpr int crossfadeSamples = 256;
+    static constexpr double maxReflectionSeconds = 0.12;
+
+    struct TapSet
+    {
+        std::array<std::array<int, maxTaps>, numSides> delays{};
+        std::array<std::array<float, maxTaps>, numSides> gains{};
+        int numTaps = 0;
+    };
+
+    struct RoomModel
+    {
+        float size = 0.5f, damping = 0.5f;
+        int numTaps = 32;
+    };
+
+    RoomModel requestedRoom() const noexcept
+    {
+        return { roomSize.load(std::memory_order_relaxed),
+                 roomDamping.load(std::memory_order_relaxed),
+                 roomTaps.load(std::memory_order_relaxed) };
+    }
+
+    //==============================================================================
+    void accumulateTaps(const TapSet& taps, int side, int readStart, float* dest, int num) const noexcept
+    {
+        juce::FloatVectorOperations::clear(dest, num);
+
+        for (int k = 0; k < taps.numTaps; ++k)
+        {
+            const auto gain = taps.gains[(size_t) side][(size_t) k];
+            const auto readIndex = (readStart - taps.delays[(size_t) side][(size_t) k]) & mask;
+            const auto firstRun = juce::jmin(num, (int) buffer.size() - readIndex);
+
+            kernels.addWithMultiply(dest, buffer.data() + readIndex, gain, firstRun);
+            kernels.addWithMultiply(dest + firstRun, buffer.data(), gain, num - firstRun);
+        }
+    }
+
+    /** Audio thread: adopts the latest finished design, if there is one. */
+    void collectNewTaps() noexcept
+    {
+        if ((sharedSlot.load(std::memory_order_acquire) & freshFlag) == 0)
+            return;
+
+        readerSlot = sharedSlot.exchange(readerSlot, std::memory_order_acq_rel) & slotMask;
+
+        previousTaps = currentTaps;
+        currentTaps = tapSets[(size_t) readerSlot];
+        fadeRemaining = crossfadeSamples;
+    }
+
+    /** Designer thread: redesigns the taps if a new room has been requested. */
+    void updateDesign()
+    {
+        const juce::ScopedLock sl(designLock);
+
+        const auto version = requestVersion.load(std::memory_order_acquire);
+
+        if (version == designedVersion || buffer.empty())
+            return;
+
+        designTaps(requestedRoom(), sampleRate, (int) std::ceil(maxReflectionSeconds * sampleRate), tapSets[(size_t) writerSlot]);
+        writerSlot = sharedSlot.exchange(writerSlot | freshFlag, std::memory_order_acq_rel) & slotMask;
+        designedVersion = version;
+    }
+
+    //==============================================================================
+    /** Evaluates a shoebox image-source model up to fourth order, for two ears, and
+        keeps the earliest reflections.
+    */
+    static void designTaps(const RoomModel& room, double rate, int maxDelay, TapSet& taps)
+    {
+        struct Reflection { float delay, gain; };
+
+        constexpr int maxOrder = 4;
+        constexpr float speedOfSound = 343.0f;
+        constexpr float earSpacing = 0.18f;
+
+        const float length = 6.0f + 24.0f * room.size;
+        const float dims[3] = { length, 0.62f * length, 3.0f + 6.0f * room.size };
+        const float source[3] = { 0.3f * dims[0], 0.6f * dims[1], 1.5f };
+        const float wallReflection = 0.9f - 0.35f * room.damping;
+
+        taps.numTaps = room.numTaps;
+
+        for (int side = 0; side < numSides; ++side)
+        {
+            const float listener[3] = { 0.65f * dims[0], 0.4f * dims[1] + (side == 0 ? -0.5f : 0.5f) * earSpacing, 1.6f };
+
+            auto distanceTo = [&](const float* point)
+            {
+                const float dx = point[0] - listener[0], dy = point[1] - listener[1], dz = point[2] - listener[2];
+                return std::sqrt(dx * dx + dy * dy + dz * dz);
+            };
+
+            const auto directDistance = distanceTo(source);
+
+            std::array<Reflection, 160> reflections;
+            size_t numReflections = 0;
+
+            for (int nx = -maxOrder; nx <= maxOrder; ++nx)
+                for (int ny = -maxOrder; ny <= maxOrder; ++ny)
+                    for (int nz = -maxOrder; nz <= maxOrder; ++nz)
+                    {
+                        const int order = std::abs(nx) + std::abs(ny) + std::abs(nz);
+
+                        if (order == 0 || order > maxOrder || numReflections == reflections.size())
+                            continue;
+
+                        const int n[3] = { nx, ny, nz };
+                        float image[3];
+
+                        for (int axis = 0; axis < 3; ++axis)
+                            image[axis] = (float) n[axis] * dims[axis]
+                                        + ((n[axis] & 1) != 0 ? dims[axis] - source[axis] : source[axis]);
+
+                        const auto distance = distanceTo(image);
+                        const auto delay = (distance - directDistance) / speedOfSound * (float) rate;
+
+                        if (delay < (float) maxDelay)
+                            reflections[numReflections++] = { delay, std::pow(wallReflection, (float) order) * directDistance / distance };
+                    }
+
+            std::sort(reflections.begin(), reflections.begin() + (long) numReflections,
+                      [](const Reflection& a, const Reflection& b) { return a.delay < b.delay; });
+
+            const auto numUsed = juce::jmin((size_t) room.numTaps, numReflections);
+            float energy = 0.0f;
+
+            for (size_t k = 0; k < numUsed; ++k)
+                energy += reflections[k].gain * reflections[k].gain;
+
+            const auto normalise = energy > 0.0f ? 1.0f / std::sqrt(energy) : 0.0f;
+
+            for (size_t k = 0; k < (size_t) maxTaps; ++k)
+            {
+                const bool used = k < numUsed;
+                taps.delays[(size_t) side][k] = used ? juce::jmax(0, juce::roundToInt(reflections[k].delay)) : 0;
+                taps.gains[(size_t) side][k] = used ? reflections[k].gain * normalise : 0.0f;
+            }
+        }
+    }
+
+    //==============================================================================
+    static constexpr int freshFlag = 4;
+    static constexpr int slotMask = 3;
+
+    juce::SharedResourcePointer<EarlyReflectionsDesigner> designer;
+    juce::CriticalSection designLock;
+
+    std::vector<float> buffer;
+    int mask = 0, writeIndex = 0, blockStart = 0, maxBlockSize = 0;
+    double sampleRate = 44100.0;
+
+    std::atomic<float> roomSize { 0.5f }, roomDamping { 0.5f };
+    std::atomic<int> roomTaps { 32 };
+    std::atomic<juce::uint32> requestVersion { 0 };
+    juce::uint32 designedVersion = 0;
+
+    // Three tap sets: one owned by the designer, one by the audio thread and one in
+    // flight between them, swapped with a single atomic exchange.
+    std::array<TapSet, 3> tapSets;
+    int writerSlot = 0, readerSlot = 1;
+    std::atomic<int> sharedSlot { 2 };
+
+    TapSet currentTaps, previousTaps;
+    int fadeRemaining = 0;
+
+    juce::SmoothedValue<float> level;
+
+    const DspKernels& kernels = DspKernels::get();
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR(EarlyReflections)
+};
+
+//==============================================================================
+/**
+    The background thread shared by every EarlyReflections instance in the process.
+    It polls its clients for room changes, so the audio thread never has to signal it.
+*/
+class EarlyReflectionsDesigner : private juce::Thread
+{
+public:
+    EarlyReflectionsDesigner() : juce::Thread("Yeti early reflections")
+    {
+        startThread(juce::Thread::Priority::low);
+    }
+
+    ~EarlyReflectionsDesigner() override
+    {
+        stopThread(1000);
+    }
+
+    void addClient(EarlyReflections* client)
+    {
+        const juce::ScopedLock sl(clientLock);
+        clients.addIfNotAlreadyThere(client);
+    }
+
+    void removeClient(EarlyReflections* client)
+    {
+        const juce::ScopedLock sl(clientLock);
+        clients.removeFirstMatchingValue(client);
+    }
+
+private:
+    void run() override
+    {
+        while (! threadShouldExit())
+        {
+            {
+                const juce::ScopedLock sl(clientLock);
+
+                for (auto* client : clients)
+                    client->updateDesign();
+            }
+
+            wait(pollIntervalMs);
+        }
+    }
+
+    static constexpr int pollIntervalMs = 20;
+
+    juce::CriticalSection clientLock;
+    juce::Array<EarlyReflections*> clients;
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR(EarlyReflectionsDesigner)
+};
+
+inline EarlyReflections::EarlyReflections()
+{
+    designer->addClient(this);
+}
+
+inline EarlyReflections::~EarlyReflections()
+{
+    designer->removeClient(this);
+}
@@ -0,0 +1,951 @@
+#pragma once
+
+#include <JuceHeader.h>
+#include "ShimmerStage.h"
+#include "RenderWorker.h"
+#include "DspKernels.h"
+#include "MemoryUsage.h"
+
+//==============================================================================
+/**
+    The feedback saturation's curve: a cubic soft clip, f(v) = v - v^3 / 3 for
+    |v| <= 1 and +-2/3 beyond, on as many lines as a register holds.
+
+    process() runs it with first-order antiderivative anti-aliasing (ADAA). It
+    returns the mean of f over the straight line from the previous input to this
+    one, (F(v1) - F(v0)) / (v1 - v0), rather than f(v1). That works on the input
+    before it's clipped, because the clip is part of f: a step that crosses +-1
+    averages the cubic up to the corner and the flat part after it. Where the
+    step is too small for the quotient to be accurate in floats, f at its
+    midpoint is used instead.
+
+    YetiWarmthBench measures how much aliasing this leaves, against tanh and
+    the curve evaluated directly.
+*/
+struct WarmthCurve
+{
+    using Lanes = juce::dsp::SIMDRegister<float>;
+
+    /** f(v), with no anti-aliasing. */
+    static Lanes apply(Lanes v) noexcept
+    {
+        const auto u = clip(v);
+        return u - u * u * u * Lanes::expand(1.0f / 3.0f);
+    }
+
+    /** F(v), the integral of f from 0. Beyond +-1, f is flat, so
+        F(v) = F(u) + f(u) (v - u) where u is v clipped.
+    */
+    static Lanes integrate(Lanes v) noexcept
+    {
+        const auto u = clip(v);
+        const auto u2 = u * u;
+
+        return u2 * (Lanes::expand(0.5f) - u2 * Lanes::expand(1.0f / 12.0f))
+             + (u - u2 * u * Lanes::expand(1.0f / 3.0f)) * (v - u);
+    }
+
+    /** The last input of each line, x * drive, and F of it. All zeros is
+        the state of a silent line.
+    */
+    struct State
+    {
+        Lanes input, integral;
+    };
+
+    /** The anti-aliased f(x * drive) / drive. */
+    static Lanes process(Lanes x, State& state, Lanes drive, Lanes inverseDrive) noexcept
+    {
+        const auto v = x * drive;
+        const auto integral = integrate(v);
+        const auto step = v - state.input;
+        const auto small = Lanes::lessThan(Lanes::abs(step), Lanes::expand(minStep));
+
+        // Small steps divide by one, so the quotient stays finite, and are
+        // replaced by the midpoint.
+        const auto quotient = divide(integral - state.integral, step + ((Lanes::expand(1.0f) - step) & small));
+        const auto midpoint = apply((v + state.input) * Lanes::expand(0.5f));
+
+        state = { v, integral };
+        return ((quotient & ~small) + (midpoint & small)) * inverseDrive;
+    }
+
+    /** Below this, F's rounding error divided by the step outweighs the
+        midpoint's error, which is about step^2 / 12 at worst.
+    */
+    static constexpr float minStep = 1.0e-3f;
+
+private:
+    static Lanes clip(Lanes v) noexcept
+    {
+        return Lanes::min(Lanes::max(v, Lanes::expand(-1.0f)), Lanes::expand(1.0f));
+    }
+
+    /** SIMDRegister has no division, so this uses the native one. */
+    static Lanes divide(Lanes numerator, Lanes denominator) noexcept
+    {
+       #if JUCE_INTEL && defined (__AVX2__)
+        return { _mm256_div_ps(numerator.value, denominator.value) };
+       #elif JUCE_INTEL
+        return { _mm_div_ps(numerator.value, denominator.value) };
+       #elif JUCE_ARM && JUCE_64BIT
+        return { vdivq_f32(numerator.value, denominator.value) };
+       #else
+        alignas(Lanes::SIMDRegisterSize) float n[Lanes::SIMDNumElements], d[Lanes::SIMDNumElements];
+        numerator.copyToRawArray(n);
+        denominator.copyToRawArray(d);
+
+        for (size_t i = 0; i < Lanes::SIMDNumElements; ++i)
+            n[i] /= d[i];
+
+        return Lanes::fromRawArray(n);
+       #endif
+    }
+};
+
+//==============================================================================
+/**
+    The Freeverb network behind the default algorithm, with optional saturation
+    in its feedback path.
+
+    This is the same comb/allpass structure and tuning as juce::dsp::Reverb, but
+    the sixteen combs (eight per channel) are laid out side by side. Each sample
+    gathers one value per comb into SIMD registers, runs the damping, feedback and
+    saturation across every line at once, and scatters the results back.
+
+    The "warmth" saturation is the anti-aliased WarmthCurve.
+
+    Modulation sweeps every comb's read position with its own slow LFO, which
+    breaks up the metallic ringing of fixed integer delays on long tails. The
+    LFOs are a phasor per line shaped by a parabolic sine approximation, evaluated
+    every 32 samples and ramped linearly in between, and the fractional reads are
+    linearly interpolated with the same register layout.
+
+    Shimmer feeds the wet output back into the combs through an octave-up
+    ShimmerStage, so every pass around the loop climbs another octave.
+
+    The output is the wet signal only, and the parameters' dryLevel is
+    ignored: the processor's OutputChain mixes the dry signal back in. With
+    warmth, modulation and shimmer all at zero the network reproduces
+    juce::dsp::Reverb with its dry level at zero.
+
+    combsPerChannel can be cut to four for a cheaper network. Every other one
+    of Freeverb's comb tunings is kept, and the input gain is raised so the
+    wet level stays about the same.
+
+    Each channel's combs live in their own cache-line-aligned CombBank. The
+    two banks share nothing but the summed input, so offline renders can run
+    them on separate threads (see setRenderWorker()).
+
+    While the shimmer is idle nothing feeds back across channels, so a block
+    runs the combs for every sample first and then each allpass and the output
+    mix over the whole block, through DspKernels.
+*/
+template <int combsPerChannel = 8>
+class FreeverbNetwork
+{
+public:
+    using Parameters = juce::Reverb::Parameters;
+
+    FreeverbNetwork()
+    {
+        setParameters(Parameters());
+    }
+
+    //==============================================================================
+    const Parameters& getParameters() const noexcept { return parameters; }
+
+    /** How long the tail takes to fall by 60 dB with these parameters, set by
+        the longest comb, or infinity when frozen. The shimmer can sustain it
+        for longer.
+    */
+    static double getDecaySeconds(const Parameters& params) noexcept
+    {
+        if (isFrozen(params.freezeMode))
+            return std::numeric_limits<double>::infinity();
+
+        const auto longestComb = combTunings[(size_t) (numCombs - 1) * (size_t) (maxCombs / numCombs)] + stereoSpread;
+        const auto combFeedback = params.roomSize * roomScaleFactor + roomOffset;
+        return (double) longestComb / 44100.0 * -3.0 / std::log10((double) combFeedback);
+    }
+
+    void setParameters(const Parameters& newParams)
+    {
+        const float wetScaleFactor = 3.0f;
+        const float wet = newParams.wetLevel * wetScaleFactor;
+
+        wetGain1.setTargetValue(0.5f * wet * (1.0f + newParams.width));
+        wetGain2.setTargetValue(0.5f * wet * (1.0f - newParams.width));
+
+        gain = isFrozen(newParams.freezeMode) ? 0.0f : 0.015f * std::sqrt((float) maxCombs / (float) numCombs);
+        parameters = newParams;
+        updateDamping();
+    }
+
+    /** Sets the amount of feedback saturation, from 0 (clean) to 1.
+
+        Anti-aliasing is on by default. Switching it off evaluates the curve
+        directly, which is only meant for a network that is already oversampled
+        (e.g. as a reference to compare against).
+    */
+    void setWarmth(float amount, bool useAntiderivative = true) noexcept
+    {
+        drive.setTargetValue(juce::jlimit(0.0f, 1.0f, amount) * maxDrive);
+        antiderivative = useAntiderivative;
+    }
+
+    /** Sets how much octave-shifted output is fed back into the combs, from 0 to 1. */
+    void setShimmer(float amount) noexcept
+    {
+        shimmerAmount = juce::jlimit(0.0f, 1.0f, amount);
+        updateDamping();
+    }
+
+    /** Tells the network it runs at ratio times the rate it is tuned for, e.g.
+        0.5 when decimated or 2 when oversampled. Delay lengths already follow
+        the sample rate, but Freeverb's damping is a fixed one-pole coefficient,
+        so this keeps its cutoff at the same frequency.
+    */
+    void setInternalRateRatio(double ratio) noexcept
+    {
+        jassert(ratio > 0.0);
+        dampingExponent = (float) (1.0 / ratio);
+        updateDamping();
+    }
+
+    /** Waking the render worker and joining it costs about 5 us, which is half
+        the work of roughly 150 samples (YetiReverbBench --split). This keeps
+        the hand-off under a tenth of what the split saves.
+    */
+    static constexpr int minSplitBlockSize = 2048;
+
+    /** Lets blocks of at least minBlockSize samples process the left and right
+        channels on two threads. Pass nullptr to keep everything on the calling
+        thread. This blocks while waiting for the worker, so it is only meant
+        for offline rendering.
+    */
+    void setRenderWorker(RenderWorker* worker, int minBlockSize = minSplitBlockSize) noexcept
+    {
+        renderWorker = worker;
+        splitBlockSize = minBlockSize;
+    }
+
+    /** Sets the depth of the comb delay modulation, from 0 (static) to 1. */
+    void setModulation(float depth) noexcept
+    {
+        modulationDepth.setTargetValue(juce::jlimit(0.0f, 1.0f, depth));
+    }
+
+    //==============================================================================
+    void prepare(const juce::dsp::ProcessSpec& spec)
+    {
+        jassert(spec.sampleRate > 0);
+
+        static const short allPassTunings[] = { 556, 441, 341, 225 };
+        const int intSampleRate = (int) spec.sampleRate;
+
+        int totalSize = 0;
+
+        for (int channel = 0; channel < numChannels; ++channel)
+        {
+            auto& bank = banks[channel];
+
+            for (size_t i = 0; i < linesPerChannel; ++i)
+            {
+                const auto tuning = combTunings[i * (size_t) (maxCombs / numCombs)];
+
+                bank.lineStart[i] = totalSize;
+                bank.lineSize[i] = (intSampleRate * (tuning + channel * stereoSpread)) / 44100;
+                bank.nominalDelay[i] = (float) bank.lineSize[i];
+
+                // One extra sample so a read at the full nominal delay can still
+                // interpolate towards the next-older sample, plus a guard copy of
+                // the first sample so an interpolated read never has to wrap.
+                bank.lineLength[i] = bank.lineSize[i] + 1;
+                totalSize += bank.lineLength[i] + 1;
+
+                const auto line = (double) ((size_t) channel * linesPerChannel + i);
+                bank.lfoIncrement[i] = (float) ((lfoBaseRate + lfoRateSpread * line) / spec.sampleRate);
+            }
+
+            for (int i = 0; i < numAllPasses; ++i)
+                allPass[channel][i].setSize((intSampleRate * (allPassTunings[i] + channel * stereoSpread)) / 44100);
+        }
+
+        combStorage.assign((size_t) totalSize, 0.0f);
+
+        blockInput.assign((size_t) spec.maximumBlockSize, 0.0f);
+        blockControls.assign((size_t) spec.maximumBlockSize, {});
+
+        for (auto& output : blockOutput)
+            output.assign((size_t) spec.maximumBlockSize, 0.0f);
+
+        shimmer.prepare(spec.sampleRate);
+        halfExcursion = (float) (maxExcursion * 0.5 * spec.sampleRate / 44100.0);
+
+        const double smoothTime = 0.01;
+        damping.reset(spec.sampleRate, smoothTime);
+        feedback.reset(spec.sampleRate, smoothTime);
+        drive.reset(spec.sampleRate, smoothTime);
+        modulationDepth.reset(spec.sampleRate, smoothTime);
+        shimmerLevel.reset(spec.sampleRate, smoothTime);
+        wetGain1.reset(spec.sampleRate, smoothTime);
+        wetGain2.reset(spec.sampleRate, smoothTime);
+
+        reset();
+    }
+
+    /** Frees everything prepare() allocated. Call prepare() again before use. */
+    void release() noexcept
+    {
+        MemoryUsage::release(combStorage);
+
+        for (auto& channel : allPass)
+            for (auto& filter : channel)
+                filter.release();
+
+        MemoryUsage::release(blockInput);
+        MemoryUsage::release(blockControls);
+
+        for (auto& output : blockOutput)
+            MemoryUsage::release(output);
+
+        shimmer.release();
+    }
+
+    void addMemoryUsage(MemoryUsage& usage) const noexcept
+    {
+        usage.delayLines += MemoryUsage::bytesOf(combStorage);
+
+        for (const auto& channel : allPass)
+            for (const auto& filter : channel)
+                filter.addMemoryUsage(usage);
+
+        usage.blockBuffers += MemoryUsage::bytesOf(blockInput) + MemoryUsage::bytesOf(blockControls);
+
+        for (const auto& output : blockOutput)
+            usage.blockBuffers += MemoryUsage::bytesOf(output);
+
+        shimmer.addMemoryUsage(usage);
+    }
+
+    void reset() noexcept
+    {
+        std::fill(combStorage.begin(), combStorage.end(), 0.0f);
+
+        for (size_t channel = 0; channel < (size_t) numChannels; ++channel)
+        {
+            auto& bank = banks[channel];
+            bank.writeIndex.fill(0);
+            bank.samplesUntilLfoUpdate = 0;
+
+            for (size_t v = 0; v < registersPerChannel; ++v)
+            {
+                bank.filterState[v] = Lanes::expand(0.0f);
+                bank.saturatorState[v] = {};
+
+                // Spread the starting phases so the lines never sweep in step.
+                alignas(registerAlignment) float phases[registerWidth] = {};
+
+                for (size_t lane = 0; lane < registerWidth && v * registerWidth + lane < linesPerChannel; ++lane)
+                    phases[lane] = (float) (channel * linesPerChannel + v * registerWidth + lane) / (float) numLines - 0.5f;
+
+                bank.lfoPhase[v] = Lanes::fromRawArray(phases);
+            }
+        }
+
+        for (int j = 0; j < numChannels; ++j)
+            for (int i = 0; i < numAllPasses; ++i)
+                allPass[j][i].clear();
+
+        shimmer.reset();
+        shimmerReturn = 0.0f;
+    }
+
+    //==============================================================================
+    template <typename ProcessContext>
+    void process(const ProcessContext& context) noexcept
+    {
+        const auto& inputBlock = context.getInputBlock();
+        auto& outputBlock = context.getOutputBlock();
+        const auto numInChannels = inputBlock.getNumChannels();
+        const auto numOutChannels = outputBlock.getNumChannels();
+        const auto numSamples = (int) outputBlock.getNumSamples();
+
+        jassert(inputBlock.getNumSamples() == outputBlock.getNumSamples());
+        outputBlock.copyFrom(inputBlock);
+
+        if (context.isBypassed)
+            return;
+
+        if (numInChannels == 1 && numOutChannels == 1)
+            processMono(outputBlock.getChannelPointer(0), numSamples);
+        else if (numInChannels == 2 && numOutChannels == 2)
+            processStereo(outputBlock.getChannelPointer(0), outputBlock.getChannelPointer(1), numSamples);
+        else
+            jassertfalse; // invalid channel configuration
+    }
+
+private:
+    //==============================================================================
+    using Lanes = juce::dsp::SIMDRegister<float>;
+    using IndexLanes = juce::dsp::SIMDRegister<int>;
+
+    static constexpr int maxCombs = 8, numCombs = combsPerChannel, numAllPasses = 4, numChannels = 2;
+    static constexpr int stereoSpread = 23;
+    static constexpr short combTunings[maxCombs] = { 1116, 1188, 1277, 1356, 1422, 1491, 1557, 1617 }; // (at 44100Hz)
+    static constexpr float roomScaleFactor = 0.28f, roomOffset = 0.7f;
+    static constexpr size_t linesPerChannel = (size_t) numCombs;
+    static constexpr size_t numLines = linesPerChannel * (size_t) numChannels;
+
+    // Each channel's lines fill whole registers. When a register holds more
+    // lanes than a channel has lines (the Eco tier's four combs in an AVX
+    // build), the padding lanes read zero and are never written back.
+    static constexpr size_t registerWidth = Lanes::SIMDNumElements;
+    static constexpr size_t registerAlignment = Lanes::SIMDRegisterSize;
+    static constexpr size_t registersPerChannel = (linesPerChannel + registerWidth - 1) / registerWidth;
+    static constexpr size_t paddedLines = registersPerChannel * registerWidth;
+
+    static constexpr float maxDrive = 8.0f;
+    static constexpr double maxExcursion = 24.0; // peak-to-peak, in samples at 44.1kHz
+    static constexpr double lfoBaseRate = 0.5, lfoRateSpread = 0.07; // Hz
+    static constexpr int lfoUpdateInterval = 32;
+    static constexpr float maxShimmerFeedback = 2.0f;
+
+    static_assert(maxCombs % numCombs == 0, "The combs are a subset of Freeverb's eight tunings");
+    static_assert(IndexLanes::SIMDNumElements == Lanes::SIMDNumElements,
+                  "Line positions are computed with the same lane layout as the samples");
+
+    static bool isFrozen(float freezeMode) noexcept { return freezeMode >= 0.5f; }
+
+    /** One channel's comb lines and their per-line state. Banks are aligned to
+        a cache line each, so two threads working on different channels never
+        write to the same line.
+    */
+    struct alignas(64) CombBank
+    {
+        alignas(registerAlignment) std::array<int, paddedLines> lineStart{}, lineSize{}, lineLength{}, writeIndex{}, readLag{};
+        alignas(registerAlignment) std::array<float, paddedLines> nominalDelay{}, lfoIncrement{}, readFraction{};
+        alignas(registerAlignment) std::array<float, paddedLines> readDelay{}, readDelayStep{};
+        Lanes filterState[registersPerChannel] {}, lfoPhase[registersPerChannel] {};
+        WarmthCurve::State saturatorState[registersPerChannel] {};
+        int samplesUntilLfoUpdate = 0;
+    };
+
+    /** The per-sample control values shared by every comb. */
+    struct CombControls
+    {
+        float damping = 0.0f, feedback = 0.0f, drive = 0.0f, modulationDepth = 0.0f;
+    };
+
+    CombControls nextCombControls() noexcept
+    {
+        return { damping.getNextValue(), feedback.getNextValue(), drive.getNextValue(), modulationDepth.getNextValue() };
+    }
+
+    void processStereo(float* left, float* right, int numSamples) noexcept
+    {
+        if (canProcessInBlocks(numSamples))
+        {
+            processStereoBlock(left, right, numSamples);
+            return;
+        }
+
+        for (int i = 0; i < numSamples; ++i)
+        {
+            const auto input = (left[i] + right[i] + shimmerReturn) * gain;
+            const auto controls = nextCombControls();
+
+            float outL = processBank(banks[0], input, controls);
+            float outR = processBank(banks[1], input, controls);
+
+            for (int j = 0; j < numAllPasses; ++j) // run the allpass filters in series
+            {
+                outL = allPass[0][j].process(outL);
+                outR = allPass[1][j].process(outR);
+            }
+
+            updateShimmer(outL + outR);
+
+            const float wet1 = wetGain1.getNextValue();
+            const float wet2 = wetGain2.getNextValue();
+
+            left[i] = outL * wet1 + outR * wet2;
+            right[i] = outR * wet1 + outL * wet2;
+        }
+    }
+
+    void processMono(float* samples, int numSamples) noexcept
+    {
+        if (canProcessInBlocks(numSamples))
+        {
+            processMonoBlock(samples, numSamples);
+            return;
+        }
+
+        for (int i = 0; i < numSamples; ++i)
+        {
+            const auto input = (samples[i] + shimmerReturn) * gain;
+            float output = processBank(banks[0], input, nextCombControls());
+
+            for (int j = 0; j < numAllPasses; ++j)
+                output = allPass[0][j].process(output);
+
+            updateShimmer(output);
+
+            samples[i] = output * wetGain1.getNextValue();
+        }
+    }
+
+    //==============================================================================
+    /** A block can be processed a stage at a time if the shimmer is idle (it
+        feeds both channels' output back into both channels' input), and it fits
+        the buffers.
+    */
+    bool canProcessInBlocks(int numSamples) const noexcept
+    {
+        return numSamples <= (int) blockInput.size()
+            && shimmerIdle && ! shimmerLevel.isSmoothing() && shimmerLevel.getTargetValue() <= 0.0f;
+    }
+
+    bool wetIsSmoothing() const noexcept
+    {
+        return wetGain1.isSmoothing() || wetGain2.isSmoothing();
+    }
+
+    /** Produces the same output as the per-sample loop in processStereo(). The
+        shared input and control values are computed up front, then each
+        channel's combs and allpasses run, on their own thread if the block is
+        long enough for the render worker, and the results are mixed once both
+        are done.
+    */
+    void processStereoBlock(float* left, float* right, int numSamples) noexcept
+    {
+        prepareBlockInput(left, right, numSamples);
+
+        if (renderWorker != nullptr && numSamples >= splitBlockSize)
+        {
+            splitTask.numSamples = numSamples;
+            renderWorker->runSplit(splitTask);
+        }
+        else
+        {
+            processBlockChannel(0, numSamples);
+            processBlockChannel(1, numSamples);
+        }
+
+        const auto* wetL = blockOutput[0].data();
+        const auto* wetR = blockOutput[1].data();
+
+        if (! wetIsSmoothing())
+        {
+            kernels.mixStereo(left, right, wetL, wetR, wetGain1.getTargetValue(), wetGain2.getTargetValue(), numSamples);
+            return;
+        }
+
+        for (int i = 0; i < numSamples; ++i)
+        {
+            const float wet1 = wetGain1.getNextValue();
+            const float wet2 = wetGain2.getNextValue();
+
+            left[i] = wetL[i] * wet1 + wetR[i] * wet2;
+            right[i] = wetR[i] * wet1 + wetL[i] * wet2;
+        }
+    }
+
+    void processMonoBlock(float* samples, int numSamples) noexcept
+    {
+        prepareBlockInput(samples, nullptr, numSamples);
+        processBlockChannel(0, numSamples);
+
+        const auto* wet = blockOutput[0].data();
+
+        // Mono only uses wetGain1, so wetGain2 never finishes smoothing here.
+        if (! wetGain1.isSmoothing())
+        {
+            juce::FloatVectorOperations::multiply(samples, wet, wetGain1.getTargetValue(), numSamples);
+            return;
+        }
+
+        for (int i = 0; i < numSamples; ++i)
+            samples[i] = wet[i] * wetGain1.getNextValue();
+    }
+
+    void prepareBlockInput(const float* left, const float* right, int numSamples) noexcept
+    {
+        for (int i = 0; i < numSamples; ++i)
+        {
+            blockInput[(size_t) i] = (right != nullptr ? left[i] + right[i] : left[i]) * gain;
+            blockControls[(size_t) i] = nextCombControls();
+        }
+    }
+
+    /** Runs one channel's combs a sample at a time, then its allpasses a block at a time. */
+    void processBlockChannel(int channel, int numSamples) noexcept
+    {
+        auto& bank = banks[channel];
+        auto* output = blockOutput[channel].data();
+
+        for (int i = 0; i < numSamples; ++i)
+            output[i] = processBank(bank, blockInput[(size_t) i], blockControls[(size_t) i]);
+
+        for (int j = 0; j < numAllPasses; ++j)
+            allPass[channel][j].process(output, numSamples, kernels);
+    }
+
+    struct SplitTask : RenderWorker::Task
+    {
+        explicit SplitTask(FreeverbNetwork& owner) : network(owner) {}
+
+        void runPart(int part) noexcept override { network.processBlockChannel(part, numSamples); }
+
+        FreeverbNetwork& network;
+        int numSamples = 0;
+    };
+
+    //==============================================================================
+    /** Feeds the network's output to the shimmer, and keeps the result to be
+        mixed into the next sample's input. The return goes in alongside the dry
+        input, so freezing (which zeroes the input gain) also stops the climb.
+    */
+    void updateShimmer(float wetOutput) noexcept
+    {
+        if (! shimmerLevel.isSmoothing() && shimmerLevel.getTargetValue() <= 0.0f)
+        {
+            if (! shimmerIdle)
+            {
+                shimmer.reset();
+                shimmerReturn = 0.0f;
+                shimmerIdle = true;
+            }
+
+            return;
+        }
+
+        shimmerIdle = false;
+        shimmerReturn = shimmer.processSample(wetOutput) * shimmerLevel.getNextValue();
+    }
+
+    /** Runs one sample through a channel's combs and returns their summed output. */
+    forcedinline float processBank(CombBank& bank, float input, const CombControls& controls) noexcept
+    {
+        alignas(registerAlignment) float newer[paddedLines], older[paddedLines];
+        const bool modulating = readBank(bank, controls.modulationDepth, newer, older);
+
+        for (auto line = linesPerChannel; line < paddedLines; ++line)
+            newer[line] = older[line] = 0.0f;
+
+        const auto damp = Lanes::expand(controls.damping);
+        const auto feedbck = Lanes::expand(controls.feedback);
+        const auto inputLanes = Lanes::expand(input);
+
+        const bool saturating = controls.drive > 0.0f;
+        const auto driveLanes = Lanes::expand(controls.drive);
+        const auto inverseDrive = Lanes::expand(saturating ? 1.0f / controls.drive : 0.0f);
+
+        alignas(registerAlignment) float written[paddedLines];
+        auto sum = Lanes::expand(0.0f);
+
+        for (size_t v = 0; v < registersPerChannel; ++v)
+        {
+            const auto index = v * registerWidth;
+            auto output = Lanes::fromRawArray(newer + index);
+
+            if (modulating)
+                output += (Lanes::fromRawArray(older + index) - output) * Lanes::fromRawArray(bank.readFraction.data() + index);
+
+            sum += output;
+            bank.filterState[v] = output + (bank.filterState[v] - output) * damp;
+
+            auto recirculated = bank.filterState[v] * feedbck;
+
+            if (saturating)
+                recirculated = saturate(recirculated, bank.saturatorState[v], driveLanes, inverseDrive);
+            else
+                bank.saturatorState[v] = {};
+
+            undenormalise(inputLanes + recirculated).copyToRawArray(written + index);
+        }
+
+        for (size_t line = 0; line < linesPerChannel; ++line)
+        {
+            auto* samples = combStorage.data() + bank.lineStart[line];
+            samples[bank.writeIndex[line]] = written[line];
+
+            if (bank.writeIndex[line] == 0)
+                samples[bank.lineLength[line]] = written[line];
+
+            if (++bank.writeIndex[line] == bank.lineLength[line])
+                bank.writeIndex[line] = 0;
+        }
+
+        return sum.sum();
+    }
+
+    /** JUCE_UNDENORMALISE for every lane, as the allpasses use: anything far
+        too small to hear comes back as zero. It's applied to what is written
+        back into the lines, so a thread without flush-to-zero set (the render
+        worker's, or a host's) never recirculates denormals at the end of a
+        long tail. The damping state would be the obvious place, but it sits on
+        the per-sample dependency chain, and once the lines are zero it dies
+        out within a few dozen samples anyway.
+    */
+    static Lanes undenormalise(Lanes value) noexcept
+    {
+        return (value + Lanes::expand(0.1f)) - Lanes::expand(0.1f);
+    }
+
+    /** Reads each comb's delayed sample into newer. When the modulation is on,
+        this also reads the next-older sample for interpolation and returns true.
+    */
+    forcedinline bool readBank(CombBank& bank, float depth, float* newer, float* older) noexcept
+    {
+        const bool modulating = depth > 0.0f;
+
+        if (! modulating)
+            bank.samplesUntilLfoUpdate = 0;
+        else if (--bank.samplesUntilLfoUpdate < 0)
+            updateModulatedReads(bank, depth);
+        else
+            advanceModulatedReads(bank);
+
+        if (! modulating)
+        {
+            for (size_t line = 0; line < linesPerChannel; ++line)
+            {
+                auto readIndex = bank.writeIndex[line] - bank.lineSize[line];
+
+                if (readIndex < 0)
+                    readIndex += bank.lineLength[line];
+
+                newer[line] = combStorage[(size_t) (bank.lineStart[line] + readIndex)];
+            }
+
+            return false;
+        }
+
+        alignas(registerAlignment) int readPositions[paddedLines];
+        computeReadPositions(bank, readPositions);
+
+        // A modulated read starts at the next-older sample. The guard sample at
+        // the end of each line means the newer one is always the next along.
+        for (size_t line = 0; line < linesPerChannel; ++line)
+        {
+            const auto* samples = combStorage.data() + readPositions[line];
+            older[line] = samples[0];
+            newer[line] = samples[1];
+        }
+
+        return true;
+    }
+
+    /** Turns per-line delays into absolute positions in combStorage, a register
+        of lines at a time.
+    */
+    static void computeReadPositions(const CombBank& bank, int* positions) noexcept
+    {
+        for (size_t v = 0; v < registersPerChannel; ++v)
+        {
+            const auto index = v * registerWidth;
+            auto readIndex = IndexLanes::fromRawArray(bank.writeIndex.data() + index) - IndexLanes::fromRawArray(bank.readLag.data() + index);
+            readIndex += IndexLanes::fromRawArray(bank.lineLength.data() + index) & IndexLanes::lessThan(readIndex, IndexLanes::expand(0));
+
+            (readIndex + IndexLanes::fromRawArray(bank.lineStart.data() + index)).copyToRawArray(positions + index);
+        }
+    }
+
+    /** Advances the LFOs by one control period. Each line's delay then ramps
+        linearly from where its LFO was to where it now is over the period, so
+        the sine only has to be evaluated once per period and the read
+        position still moves smoothly every sample. Stepping it once a period
+        instead puts sidebands at multiples of the update rate around every
+        partial (about -34 dB for a 15 kHz sine at full depth).
+    */
+    void updateModulatedReads(CombBank& bank, float depth) noexcept
+    {
+        // The LFOs only ever shorten the delay, so reads stay inside the nominal
+        // length and never overtake the write position.
+        const auto excursion = Lanes::expand(depth * halfExcursion);
+        const auto periods = Lanes::expand((float) lfoUpdateInterval);
+        const auto inversePeriods = Lanes::expand(1.0f / (float) lfoUpdateInterval);
+
+        for (size_t v = 0; v < registersPerChannel; ++v)
+        {
+            const auto index = v * registerWidth;
+            const auto nominal = Lanes::fromRawArray(bank.nominalDelay.data() + index);
+            const auto start = nominal - (polySine(bank.lfoPhase[v]) + Lanes::expand(1.0f)) * excursion;
+
+            const auto phase = bank.lfoPhase[v] + Lanes::fromRawArray(bank.lfoIncrement.data() + index) * periods;
+            bank.lfoPhase[v] = phase - (Lanes::expand(1.0f) & Lanes::greaterThanOrEqual(phase, Lanes::expand(0.5f)));
+
+            const auto end = nominal - (polySine(bank.lfoPhase[v]) + Lanes::expand(1.0f)) * excursion;
+
+            start.copyToRawArray(bank.readDelay.data() + index);
+            ((end - start) * inversePeriods).copyToRawArray(bank.readDelayStep.data() + index);
+        }
+
+        setReadLags(bank);
+        bank.samplesUntilLfoUpdate = lfoUpdateInterval - 1;
+    }
+
+    /** Moves every line's delay one sample along its ramp. */
+    static void advanceModulatedReads(CombBank& bank) noexcept
+    {
+        for (size_t v = 0; v < registersPerChannel; ++v)
+        {
+            const auto index = v * registerWidth;
+
+            (Lanes::fromRawArray(bank.readDelay.data() + index) + Lanes::fromRawArray(bank.readDelayStep.data() + index))
+                .copyToRawArray(bank.readDelay.data() + index);
+        }
+
+        setReadLags(bank);
+    }
+
+    /** Splits each line's fractional delay into the whole samples to go back
+        from the write position, and the fraction towards the next-older one.
+    */
+    static void setReadLags(CombBank& bank) noexcept
+    {
+        for (size_t line = 0; line < linesPerChannel; ++line)
+        {
+            const auto whole = (int) bank.readDelay[line];
+
+            bank.readLag[line] = whole + 1;
+            bank.readFraction[line] = bank.readDelay[line] - (float) whole;
+        }
+    }
+
+    /** sin(2 pi phase) for phase in [-0.5, 0.5), from a parabola with one
+        correction step (peak error around 0.1%).
+    */
+    static Lanes polySine(Lanes phase) noexcept
+    {
+        const auto x = phase * Lanes::expand(2.0f);
+        const auto y = x * Lanes::expand(4.0f) * (Lanes::expand(1.0f) - Lanes::abs(x));
+
+        return y + (y * Lanes::abs(y) - y) * Lanes::expand(0.225f);
+    }
+
+    Lanes saturate(Lanes x, WarmthCurve::State& state, Lanes driveLanes, Lanes inverseDrive) const noexcept
+    {
+        if (! antiderivative)
+            return WarmthCurve::apply(x * driveLanes) * inverseDrive;
+
+        return WarmthCurve::process(x, state, driveLanes, inverseDrive);
+    }
+
+    void updateDamping() noexcept
+    {
+        const float dampScaleFactor = 0.4f;
+
+        if (isFrozen(parameters.freezeMode))
+        {
+            damping.setTargetValue(0.0f);
+            feedback.setTargetValue(1.0f);
+        }
+        else
+        {
+            const auto pole = parameters.damping * dampScaleFactor;
+            damping.setTargetValue(juce::exactlyEqual(dampingExponent, 1.0f) ? pole : std::pow(pole, dampingExponent));
+            feedback.setTargetValue(parameters.roomSize * roomScaleFactor + roomOffset);
+        }
+
+        // The network's energy gain grows like 1 / (1 - g^2) with the comb
+        // feedback g, so the shimmer return is scaled by the inverse square root
+        // to keep the octave loop below unity gain at every size.
+        const auto combFeedback = parameters.roomSize * roomScaleFactor + roomOffset;
+        shimmerLevel.setTargetValue(shimmerAmount * maxShimmerFeedback * std::sqrt(1.0f - combFeedback * combFeedback));
+    }
+
+    //==============================================================================
+    class AllPassFilter
+    {
+    public:
+        void setSize(int size)
+        {
+            buffer.assign((size_t) size, 0.0f);
+            bufferIndex = 0;
+        }
+
+        void clear() noexcept
+        {
+            std::fill(buffer.begin(), buffer.end(), 0.0f);
+        }
+
+        void release() noexcept
+        {
+            MemoryUsage::release(buffer);
+            bufferIndex = 0;
+        }
+
+        void addMemoryUsage(MemoryUsage& usage) const noexcept
+        {
+            usage.delayLines += MemoryUsage::bytesOf(buffer);
+        }
+
+        float process(float input) noexcept
+        {
+            const float bufferedValue = buffer[(size_t) bufferIndex];
+            float temp = input + (bufferedValue * 0.5f);
+            JUCE_UNDENORMALISE(temp);
+            buffer[(size_t) bufferIndex] = temp;
+
+            if (++bufferIndex == (int) buffer.size())
+                bufferIndex = 0;
+
+            return bufferedValue - input;
+        }
+
+        /** Processes a block in place, in stretches that stop at the end of the buffer. */
+        void process(float* samples, int numSamples, const DspKernels& kernels) noexcept
+        {
+            while (numSamples > 0)
+            {
+                const auto run = juce::jmin(numSamples, (int) buffer.size() - bufferIndex);
+                kernels.allPass(samples, buffer.data() + bufferIndex, run);
+
+                samples += run;
+                numSamples -= run;
+                bufferIndex += run;
+
+                if (bufferIndex == (int) buffer.size())
+                    bufferIndex = 0;
+            }
+        }
+
+    private:
+        std::vector<float> buffer;
+        int bufferIndex = 0;
+    };
+
+    //==============================================================================
+    Parameters parameters;
+    float gain = 0.015f;
+    float shimmerAmount = 0.0f;
+    float dampingExponent = 1.0f;
+    bool antiderivative = true;
+
+    std::vector<float> combStorage;
+    CombBank banks[numChannels];
+    float halfExcursion = 0.0f;
+
+    AllPassFilter allPass[numChannels][numAllPasses];
+
+    ShimmerStage shimmer;
+    float shimmerReturn = 0.0f;
+    bool shimmerIdle = true;
+
+    RenderWorker* renderWorker = nullptr;
+    int splitBlockSize = minSplitBlockSize;
+    SplitTask splitTask { *this };
+    std::vector<float> blockInput;
+    std::vector<CombControls> blockControls;
+    std::vector<float> blockOutput[numChannels];
+
+    const DspKernels& kernels = DspKernels::get();
+
+    juce::SmoothedValue<float> damping, feedback, drive, modulationDepth, shimmerLevel, wetGain1, wetGain2;
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR(FreeverbNetwork)
+};
@@ -0,0 +1,61 @@
+#pragma once
+
+#include <JuceHeader.h>
+
+//==============================================================================
+/**
+    How much memory an instance holds, by what it is used for.
+
+    Each engine adds what its prepare() allocated through addMemoryUsage(). Only
+    the storage itself is counted, not the allocator's own bookkeeping. The few
+    bytes of state inside JUCE's filters and FFT engines aren't counted either.
+*/
+struct MemoryUsage
+{
+    size_t delayLines = 0;    // comb, allpass, tank and reflection delay memory
+    size_t spectral = 0;      // the shimmer's FFT frames, spectra and window
+    size_t blockBuffers = 0;  // scratch sized to the largest block
+    size_t objects = 0;       // the processor object itself, engines included
+
+    size_t getTotal() const noexcept { return delayLines + spectral + blockBuffers + objects; }
+
+    MemoryUsage& operator+= (const MemoryUsage& other) noexcept
+    {
+        delayLines += other.delayLines;
+        spectral += other.spectral;
+        blockBuffers += other.blockBuffers;
+        objects += other.objects;
+        return *this;
+    }
+
+    //==============================================================================
+    template <typename T>
+    static size_t bytesOf(const std::vector<T>& vector) noexcept
+    {
+        return vector.capacity() * sizeof(T);
+    }
+
+    /** An estimate of what the buffer's setSize() allocated. That is each
+        channel padded to a multiple of four samples, the list of channel
+        pointers rounded up to 16 bytes, and 32 spare bytes. JUCE doesn't expose
+        the real figure, and the constructor pads a little less.
+    */
+    static size_t bytesOf(const juce::AudioBuffer<float>& buffer) noexcept
+    {
+        const auto numChannels = (size_t) buffer.getNumChannels();
+
+        if (numChannels == 0 || buffer.getNumSamples() == 0)
+            return 0;
+
+        const auto paddedSamples = ((size_t) buffer.getNumSamples() + 3) & ~(size_t) 3;
+        const auto channelList = ((numChannels + 1) * sizeof(float*) + 15) & ~(size_t) 15;
+        return numChannels * paddedSamples * sizeof(float) + channelList + 32;
+    }
+
+    /** Frees a vector's storage. Neither clear() nor assign() gives it back. */
+    template <typename T>
+    static void release(std::vector<T>& vector) noexcept
+    {
+        std::vector<T>().swap(vector);
+    }
+};
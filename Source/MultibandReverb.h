@@ -0,0 +1,377 @@
+#pragma once
+
+#include <JuceHeader.h>
+#include "MemoryUsage.h"
+
+//==============================================================================
+/**
+    A Freeverb network with a separate decay time for each of four frequency bands.
+
+    The mono reverb input is split by Linkwitz-Riley crossovers into four bands, and
+    each band becomes one lane of a SIMD register. Every comb filter stores a whole
+    register per sample and applies a per-lane feedback gain, so the four band decays
+    are computed by one comb bank instead of four separate networks. The lanes are
+    summed after the combs, and Freeverb's allpasses then run once on the sum.
+
+    The output is wet only. With all band decays at 1x it matches juce::dsp::Reverb
+    with no dry signal, apart from the allpass phase of the crossover.
+*/
+class MultibandReverb
+{
+public:
+    using Parameters = juce::Reverb::Parameters;
+
+    static constexpr int numBands = 4;
+
+    /** Per-band RT60 multipliers, applied on top of the room size. */
+    using BandDecays = std::array<float, (size_t) numBands>;
+
+    MultibandReverb() = default;
+
+    //==============================================================================
+    const Parameters& getParameters() const noexcept { return parameters; }
+
+    /** The RT60 of the slowest band with these settings, from the longest comb,
+        or infinity when frozen.
+    */
+    static double getDecaySeconds(const Parameters& params, const BandDecays& decays) noexcept
+    {
+        if (params.freezeMode >= 0.5f)
+            return std::numeric_limits<double>::infinity();
+
+        const auto longestComb = (1617.0 + stereoSpread) / 44100.0;
+        const auto reference = longestComb * -3.0 / std::log10((double) (params.roomSize * 0.28f + 0.7f));
+        return reference * (double) *std::max_element(decays.begin(), decays.end());
+    }
+
+    void setParameters(const Parameters& newParams)
+    {
+        const float wetScaleFactor = 3.0f;
+        const float wet = newParams.wetLevel * wetScaleFactor;
+
+        wetGain1.setTargetValue(0.5f * wet * (1.0f + newParams.width));
+        wetGain2.setTargetValue(0.5f * wet * (1.0f - newParams.width));
+
+        parameters = newParams;
+        updateDecay();
+    }
+
+    void setBandDecays(const BandDecays& newDecays)
+    {
+        bandDecays = newDecays;
+        updateDecay();
+    }
+
+    //==============================================================================
+    void prepare(const juce::dsp::ProcessSpec& spec)
+    {
+        jassert(spec.sampleRate > 0);
+
+        static const short combTunings[] = { 1116, 1188, 1277, 1356, 1422, 1491, 1557, 1617 }; // (at 44100Hz)
+        static const short allPassTunings[] = { 556, 441, 341, 225 };
+        const int intSampleRate = (int) spec.sampleRate;
+
+        for (int i = 0; i < numCombs; ++i)
+        {
+            comb[0][i].setSize((intSampleRate * combTunings[i]) / 44100);
+            comb[1][i].setSize((intSampleRate * (combTunings[i] + stereoSpread)) / 44100);
+        }
+
+        for (int i = 0; i < numAllPasses; ++i)
+        {
+            allPass[0][i].setSize((intSampleRate * allPassTunings[i]) / 44100);
+            allPass[1][i].setSize((intSampleRate * (allPassTunings[i] + stereoSpread)) / 44100);
+        }
+
+        // Three crossovers give four bands. The low and high halves of the first split
+        // each pass through the other half's crossover as an allpass, so the bands
+        // still sum flat.
+        const juce::dsp::ProcessSpec monoSpec { spec.sampleRate, spec.maximumBlockSize, 1 };
+
+        for (auto* filter : { &lowSplit, &lowMidSplit, &highMidSplit, &lowPhaseMatch, &highPhaseMatch })
+            filter->prepare(monoSpec);
+
+        lowMidSplit.setCutoffFrequency(crossoverFrequencies[1]);
+        lowSplit.setCutoffFrequency(crossoverFrequencies[0]);
+        highMidSplit.setCutoffFrequency(crossoverFrequencies[2]);
+        lowPhaseMatch.setCutoffFrequency(crossoverFrequencies[2]);
+        highPhaseMatch.setCutoffFrequency(crossoverFrequencies[0]);
+        lowPhaseMatch.setType(juce::dsp::LinkwitzRileyFilterType::allpass);
+        highPhaseMatch.setType(juce::dsp::LinkwitzRileyFilterType::allpass);
+
+        const double smoothTime = 0.01;
+        damping.reset(spec.sampleRate, smoothTime);
+        wetGain1.reset(spec.sampleRate, smoothTime);
+        wetGain2.reset(spec.sampleRate, smoothTime);
+
+        for (auto& value : feedback)
+            value.reset(spec.sampleRate, smoothTime);
+
+        updateDecay();
+    }
+
+    void reset() noexcept
+    {
+        for (int j = 0; j < numChannels; ++j)
+        {
+            for (int i = 0; i < numCombs; ++i)
+                comb[j][i].clear();
+
+            for (int i = 0; i < numAllPasses; ++i)
+                allPass[j][i].clear();
+        }
+
+        for (auto* filter : { &lowSplit, &lowMidSplit, &highMidSplit, &lowPhaseMatch, &highPhaseMatch })
+            filter->reset();
+    }
+
+    void addMemoryUsage(MemoryUsage& usage) const noexcept
+    {
+        for (int j = 0; j < numChannels; ++j)
+        {
+            for (int i = 0; i < numCombs; ++i)
+                usage.delayLines += comb[j][i].getMemoryUsage();
+
+            for (int i = 0; i < numAllPasses; ++i)
+                usage.delayLines += allPass[j][i].getMemoryUsage();
+        }
+    }
+
+    //==============================================================================
+    template <typename ProcessContext>
+    void process(const ProcessContext& context) noexcept
+    {
+        const auto& inputBlock = context.getInputBlock();
+        auto& outputBlock = context.getOutputBlock();
+        const auto numInChannels = inputBlock.getNumChannels();
+        const auto numOutChannels = outputBlock.getNumChannels();
+        const auto numSamples = (int) outputBlock.getNumSamples();
+
+        jassert(inputBlock.getNumSamples() == outputBlock.getNumSamples());
+        outputBlock.copyFrom(inputBlock);
+
+        if (context.isBypassed)
+            return;
+
+        if (numInChannels == 1 && numOutChannels == 1)
+            processMono(outputBlock.getChannelPointer(0), numSamples);
+        else if (numInChannels == 2 && numOutChannels == 2)
+            processStereo(outputBlock.getChannelPointer(0), outputBlock.getChannelPointer(1), numSamples);
+        else
+            jassertfalse; // invalid channel configuration
+    }
+
+private:
+    //==============================================================================
+    using Lanes = juce::dsp::SIMDRegister<float>;
+
+    // Each band is one lane. Wider registers (AVX, when the plugin is built
+    // for it) carry the bands in their low lanes and leave the rest at zero.
+    static constexpr size_t registerWidth = Lanes::SIMDNumElements;
+    static constexpr size_t registerAlignment = Lanes::SIMDRegisterSize;
+    static_assert(registerWidth >= (size_t) numBands, "Each band needs a lane of its own");
+
+    void processStereo(float* left, float* right, int numSamples) noexcept
+    {
+        for (int i = 0; i < numSamples; ++i)
+        {
+            const auto input = splitBands((left[i] + right[i]) * gain);
+            const auto damp = Lanes::expand(damping.getNextValue());
+            const auto feedbck = nextFeedback();
+
+            auto bandsL = Lanes::expand(0.0f), bandsR = Lanes::expand(0.0f);
+
+            for (int j = 0; j < numCombs; ++j) // accumulate the comb filters in parallel
+            {
+                bandsL += comb[0][j].process(input, damp, feedbck);
+                bandsR += comb[1][j].process(input, damp, feedbck);
+            }
+
+            float outL = bandsL.sum(), outR = bandsR.sum();
+
+            for (int j = 0; j < numAllPasses; ++j) // run the allpass filters in series
+            {
+                outL = allPass[0][j].process(outL);
+                outR = allPass[1][j].process(outR);
+            }
+
+            const float wet1 = wetGain1.getNextValue();
+            const float wet2 = wetGain2.getNextValue();
+
+            left[i] = outL * wet1 + outR * wet2;
+            right[i] = outR * wet1 + outL * wet2;
+        }
+    }
+
+    void processMono(float* samples, int numSamples) noexcept
+    {
+        for (int i = 0; i < numSamples; ++i)
+        {
+            const auto input = splitBands(samples[i] * gain);
+            const auto damp = Lanes::expand(damping.getNextValue());
+            const auto feedbck = nextFeedback();
+
+            auto bands = Lanes::expand(0.0f);
+
+            for (int j = 0; j < numCombs; ++j)
+                bands += comb[0][j].process(input, damp, feedbck);
+
+            float output = bands.sum();
+
+            for (int j = 0; j < numAllPasses; ++j)
+                output = allPass[0][j].process(output);
+
+            samples[i] = output * wetGain1.getNextValue();
+        }
+    }
+
+    Lanes splitBands(float input) noexcept
+    {
+        float low = 0.0f, high = 0.0f;
+        lowMidSplit.processSample(0, input, low, high);
+
+        alignas(registerAlignment) float bands[registerWidth] = {};
+        lowSplit.processSample(0, lowPhaseMatch.processSample(0, low), bands[0], bands[1]);
+        highMidSplit.processSample(0, highPhaseMatch.processSample(0, high), bands[2], bands[3]);
+
+        return Lanes::fromRawArray(bands);
+    }
+
+    Lanes nextFeedback() noexcept
+    {
+        if (! feedbackSmoothing)
+            return feedbackLanes;
+
+        alignas(registerAlignment) float values[registerWidth] = {};
+        feedbackSmoothing = false;
+
+        for (size_t band = 0; band < (size_t) numBands; ++band)
+        {
+            values[band] = feedback[band].getNextValue();
+            feedbackSmoothing = feedbackSmoothing || feedback[band].isSmoothing();
+        }
+
+        feedbackLanes = Lanes::fromRawArray(values);
+        return feedbackLanes;
+    }
+
+    void updateDecay() noexcept
+    {
+        const bool frozen = parameters.freezeMode >= 0.5f;
+        gain = frozen ? 0.0f : 0.015f;
+        damping.setTargetValue(frozen ? 0.0f : parameters.damping * 0.4f);
+
+        // Freeverb's size -> feedback mapping sets the reference decay. RT60 is
+        // proportional to 1 / -ln(g), so scaling a band's decay time by m means
+        // raising its feedback to the power 1 / m.
+        const float combFeedback = parameters.roomSize * 0.28f + 0.7f;
+
+        for (size_t band = 0; band < (size_t) numBands; ++band)
+            feedback[band].setTargetValue(frozen ? 1.0f : std::pow(combFeedback, 1.0f / bandDecays[band]));
+
+        feedbackSmoothing = true;
+    }
+
+    //==============================================================================
+    class CombFilter
+    {
+    public:
+        void setSize(int size)
+        {
+            buffer.assign((size_t) size, Lanes::expand(0.0f));
+            bufferIndex = 0;
+            last = Lanes::expand(0.0f);
+        }
+
+        void clear() noexcept
+        {
+            std::fill(buffer.begin(), buffer.end(), Lanes::expand(0.0f));
+            last = Lanes::expand(0.0f);
+        }
+
+        size_t getMemoryUsage() const noexcept { return MemoryUsage::bytesOf(buffer); }
+
+        Lanes process(Lanes input, Lanes damp, Lanes feedbackLevel) noexcept
+        {
+            const auto output = buffer[(size_t) bufferIndex];
+            last = output + (last - output) * damp;
+
+            buffer[(size_t) bufferIndex] = snapToZero(input + last * feedbackLevel);
+
+            if (++bufferIndex == (int) buffer.size())
+                bufferIndex = 0;
+
+            return output;
+        }
+
+    private:
+        /** Flushes lanes that have decayed below audibility, like JUCE_UNDENORMALISE
+            does for the scalar combs.
+        */
+        static Lanes snapToZero(Lanes value) noexcept
+        {
+            const auto threshold = Lanes::expand(1.0e-15f);
+            return value & (Lanes::greaterThan(value, threshold) | Lanes::lessThan(value, Lanes::expand(-1.0e-15f)));
+        }
+
+        std::vector<Lanes> buffer;
+        int bufferIndex = 0;
+        Lanes last = Lanes::expand(0.0f);
+    };
+
+    //==============================================================================
+    class AllPassFilter
+    {
+    public:
+        void setSize(int size)
+        {
+            buffer.assign((size_t) size, 0.0f);
+            bufferIndex = 0;
+        }
+
+        void clear() noexcept
+        {
+            std::fill(buffer.begin(), buffer.end(), 0.0f);
+        }
+
+        size_t getMemoryUsage() const noexcept { return MemoryUsage::bytesOf(buffer); }
+
+        float process(float input) noexcept
+        {
+            const float bufferedValue = buffer[(size_t) bufferIndex];
+            float temp = input + (bufferedValue * 0.5f);
+            JUCE_UNDENORMALISE(temp);
+            buffer[(size_t) bufferIndex] = temp;
+
+            if (++bufferIndex == (int) buffer.size())
+                bufferIndex = 0;
+
+            return bufferedValue - input;
+        }
+
+    private:
+        std::vector<float> buffer;
+        int bufferIndex = 0;
+    };
+
+    //==============================================================================
+    static constexpr int numCombs = 8, numAllPasses = 4, numChannels = 2;
+    static constexpr int stereoSpread = 23;
+    static constexpr float crossoverFrequencies[numBands - 1] = { 250.0f, 1500.0f, 6000.0f };
+
+    Parameters parameters;
+    BandDecays bandDecays { 1.0f, 1.0f, 1.0f, 1.0f };
+    float gain = 0.015f;
+
+    CombFilter comb[numChannels][numCombs];
+    AllPassFilter allPass[numChannels][numAllPasses];
+
+    juce::dsp::LinkwitzRileyFilter<float> lowSplit, lowMidSplit, highMidSplit, lowPhaseMatch, highPhaseMatch;
+
+    juce::SmoothedValue<float> damping, wetGain1, wetGain2;
+    std::array<juce::SmoothedValue<float>, (size_t) numBands> feedback;
+    Lanes feedbackLanes = Lanes::expand(0.0f);
+    bool feedbackSmoothing = true;
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR(MultibandReverb)
+};
@@ -0,0 +1,137 @@
+#pragma once
+
+#include <JuceHeader.h>
+#include "DspKernels.h"
+
+//==============================================================================
+/**
+    The last stretch of the signal path: the dry signal mixed back under the
+    reverb, then the low and high shelves.
+
+    The engines run wet-only and the processor keeps a copy of the dry input.
+    This chain adds it back and filters the result in a single pass over the
+    block (see DspKernels::outputChain). Each block runs a variant built at
+    compile time from only the stages it needs. At 100% wet the dry stage
+    isn't there at all. While the mix is steady, its gain ramp isn't either.
+*/
+class OutputChain
+{
+public:
+    OutputChain() = default;
+
+    //==============================================================================
+    void prepare(double sampleRate) noexcept
+    {
+        rampLength = (int) std::floor(smoothingSeconds * sampleRate);
+    }
+
+    /** Clears the shelves, and jumps the dry gain to its target. */
+    void reset() noexcept
+    {
+        for (auto* shelf : { &state.lowShelf, &state.highShelf })
+            for (auto& channelState : shelf->state)
+                std::fill(std::begin(channelState), std::end(channelState), 0.0f);
+
+        state.dryGain.current = state.dryGain.target;
+        state.dryGain.countdown = 0;
+    }
+
+    /** Sets the gain the dry signal ramps to, the way juce::SmoothedValue would. */
+    void setDryGain(float newGain) noexcept
+    {
+        auto& ramp = state.dryGain;
+
+        if (juce::exactlyEqual(newGain, ramp.target))
+            return;
+
+        ramp.target = newGain;
+
+        if (rampLength <= 0)
+        {
+            ramp.current = newGain;
+            ramp.countdown = 0;
+            return;
+        }
+
+        ramp.countdown = rampLength;
+        ramp.step = (ramp.target - ramp.current) / (float) ramp.countdown;
+    }
+
+    /** The unnormalised coefficients of a biquad, b0, b1, b2, a0, a1, a2, as
+        juce::dsp::IIR::ArrayCoefficients returns them.
+    */
+    using BiquadCoefficients = std::array<float, 6>;
+
+    /** Sets the shelves' coefficients. Unlike IIR::Coefficients, building these
+        doesn't allocate, so they can be recalculated on the audio thread.
+    */
+    void setShelves(const BiquadCoefficients& lowShelf, const BiquadCoefficients& highShelf) noexcept
+    {
+        copyCoefficients(lowShelf, state.lowShelf);
+        copyCoefficients(highShelf, state.highShelf);
+    }
+
+    /** False once the dry signal has faded out, so the caller can skip copying it. */
+    bool needsDry() const noexcept
+    {
+        return state.dryGain.countdown > 0 || ! juce::exactlyEqual(state.dryGain.target, 0.0f);
+    }
+
+    /** Mixes the dry signal into the block and runs the shelves over it. dry
+        must have at least as many channels and samples as the block.
+    */
+    void process(const juce::dsp::AudioBlock<float>& block, const juce::AudioBuffer<float>& dry) noexcept
+    {
+        const auto numSamples = (int) block.getNumSamples();
+        const auto stereo = block.getNumChannels() >= 2;
+
+        const auto variant = ! needsDry()                 ? DspKernels::wetOnly
+                           : state.dryGain.countdown == 0 ? DspKernels::steadyDry
+                                                          : DspKernels::smoothedDry;
+
+        jassert(variant == DspKernels::wetOnly || (dry.getNumChannels() >= (int) block.getNumChannels()
+                                                   && dry.getNumSamples() >= numSamples));
+
+        kernels.outputChain[variant](state,
+                                     block.getChannelPointer(0),
+                                     stereo ? block.getChannelPointer(1) : nullptr,
+                                     variant == DspKernels::wetOnly ? nullptr : dry.getReadPointer(0),
+                                     variant == DspKernels::wetOnly || ! stereo ? nullptr : dry.getReadPointer(1),
+                                     numSamples);
+    }
+
+    /** Runs just the shelves over the block, leaving the dry gain where it is.
+        Used for the reverb's tail while the plugin is bypassed.
+    */
+    void processWet(const juce::dsp::AudioBlock<float>& block) noexcept
+    {
+        kernels.outputChain[DspKernels::wetOnly](state,
+                                                 block.getChannelPointer(0),
+                                                 block.getNumChannels() >= 2 ? block.getChannelPointer(1) : nullptr,
+                                                 nullptr, nullptr,
+                                                 (int) block.getNumSamples());
+    }
+
+private:
+    //==============================================================================
+    static constexpr double smoothingSeconds = 0.01; // the same as the engines' own smoothing
+
+    /** Normalises so a0 = 1, the same way IIR::Coefficients does. */
+    static void copyCoefficients(const BiquadCoefficients& coefficients, OutputChainState::Shelf& shelf) noexcept
+    {
+        const auto a0Inv = ! juce::approximatelyEqual(coefficients[3], 0.0f) ? 1.0f / coefficients[3] : 0.0f;
+
+        shelf.coefficients[0] = coefficients[0] * a0Inv;
+        shelf.coefficients[1] = coefficients[1] * a0Inv;
+        shelf.coefficients[2] = coefficients[2] * a0Inv;
+        shelf.coefficients[3] = coefficients[4] * a0Inv;
+        shelf.coefficients[4] = coefficients[5] * a0Inv;
+    }
+
+    OutputChainState state {};
+    int rampLength = 0;
+
+    const DspKernels& kernels = DspKernels::get();
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR(OutputChain)
+};
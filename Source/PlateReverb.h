@@ -0,0 +1,426 @@
+#pragma once
+
+#include <JuceHeader.h>
+#include "MemoryUsage.h"
+
+//==============================================================================
+/**
+    A plate reverb after Dattorro's figure-eight tank ("Effect Design, Part 1", 1997).
+
+    The structure is laid out so that every stage runs as lanes of a single
+    juce::dsp::SIMDRegister:
+
+    - The four series input diffusers are pipelined, one sample of skew per stage, so
+      each lane is a diffuser fed by the previous lane's output from the sample before.
+    - Both allpasses of both tank halves run side by side. Each of them is fed through
+      a long tank delay, so within one sample none depends on another's output.
+
+    Each lane group keeps its delay lines interleaved with a shared write index. Writes
+    are a single vector store and only the per-lane reads are gathered. Each side's
+    seven output taps are gathered into two four-lane vectors, or one eight-lane one,
+    and reduced with one multiply per vector.
+
+    The parameters are shared with juce::dsp::Reverb so this engine can sit behind the
+    same size/damp/width/mix controls. It outputs only the wet signal and ignores dryLevel.
+*/
+class PlateReverb
+{
+public:
+    using Parameters = juce::Reverb::Parameters;
+
+    PlateReverb() = default;
+
+    //==============================================================================
+    const Parameters& getParameters() const noexcept { return parameters; }
+
+    /** The RT60 with these parameters, or infinity when frozen. The tank decays
+        at the rate Freeverb's average comb does, see updateDecay().
+    */
+    static double getDecaySeconds(const Parameters& params) noexcept
+    {
+        if (params.freezeMode >= 0.5f)
+            return std::numeric_limits<double>::infinity();
+
+        return referenceCombSeconds * -3.0 / std::log10((double) (params.roomSize * 0.28f + 0.7f));
+    }
+
+    void setParameters(const Parameters& newParams)
+    {
+        const float wetScaleFactor = 3.0f;
+        const float wet = newParams.wetLevel * wetScaleFactor;
+
+        wetGain1.setTargetValue(0.5f * wet * (1.0f + newParams.width));
+        wetGain2.setTargetValue(0.5f * wet * (1.0f - newParams.width));
+
+        parameters = newParams;
+        updateDecay();
+    }
+
+    //==============================================================================
+    void prepare(const juce::dsp::ProcessSpec& spec)
+    {
+        jassert(spec.sampleRate > 0);
+
+        const auto scale = spec.sampleRate / dattorroSampleRate;
+        auto scaled = [scale](int length) { return juce::jmax(1, juce::roundToInt(length * scale)); };
+
+        excursion = (float) (16.0 * scale);
+        const auto maxExcursion = (int) std::ceil(excursion) + 1;
+
+        inputDiffusers.setLengths({ scaled(142), scaled(107), scaled(379), scaled(277) }, 0);
+        tankAllPasses.setLengths({ scaled(672), scaled(908), scaled(1800), scaled(2656) }, maxExcursion);
+        tankDelays.setLengths({ scaled(4453), scaled(4217), scaled(3720), scaled(3163) }, 0);
+
+        // Dattorro's output taps, as (lane group, lane, delay, sign). Lanes are
+        // { left, right } for the first tank delay/allpass and { 2, 3 } for the second.
+        const TapSource leftSources[] = {
+            { tankDelay, 1, 266, 1.0f }, { tankDelay, 1, 2974, 1.0f }, { tankAllPass, 3, 1913, -1.0f },
+            { tankDelay, 3, 1996, 1.0f }, { tankDelay, 0, 1990, -1.0f }, { tankAllPass, 2, 187, -1.0f },
+            { tankDelay, 2, 1066, -1.0f }
+        };
+
+        const TapSource rightSources[] = {
+            { tankDelay, 0, 353, 1.0f }, { tankDelay, 0, 3627, 1.0f }, { tankAllPass, 2, 1228, -1.0f },
+            { tankDelay, 2, 2673, 1.0f }, { tankDelay, 1, 2111, -1.0f }, { tankAllPass, 3, 335, -1.0f },
+            { tankDelay, 3, 121, -1.0f }
+        };
+
+        for (size_t i = 0; i < numTapsPerSide; ++i)
+        {
+            leftTaps[i] = { leftSources[i].group, leftSources[i].lane, scaled(leftSources[i].delay) };
+            rightTaps[i] = { rightSources[i].group, rightSources[i].lane, scaled(rightSources[i].delay) };
+            leftTapGains[i] = outputGain * leftSources[i].sign;
+            rightTapGains[i] = outputGain * rightSources[i].sign;
+        }
+
+        const auto lfoIncrement = juce::MathConstants<double>::twoPi * lfoRateHz / spec.sampleRate;
+        lfoCos = (float) std::cos(lfoIncrement);
+        lfoSin = (float) std::sin(lfoIncrement);
+
+        const double smoothTime = 0.01;
+        damping.reset(spec.sampleRate, smoothTime);
+        decay.reset(spec.sampleRate, smoothTime);
+        wetGain1.reset(spec.sampleRate, smoothTime);
+        wetGain2.reset(spec.sampleRate, smoothTime);
+
+        updateDecay();
+        reset();
+    }
+
+    void reset() noexcept
+    {
+        inputDiffusers.clear();
+        tankAllPasses.clear();
+        tankDelays.clear();
+
+        diffuserOutputs = Lanes::expand(0.0f);
+        dampingState = Lanes::expand(0.0f);
+        bandwidthState = 0.0f;
+        lfoX = 1.0f;
+        lfoY = 0.0f;
+    }
+
+    void addMemoryUsage(MemoryUsage& usage) const noexcept
+    {
+        for (const auto* lines : { &inputDiffusers, &tankAllPasses, &tankDelays })
+            usage.delayLines += lines->getMemoryUsage();
+    }
+
+    //==============================================================================
+    template <typename ProcessContext>
+    void process(const ProcessContext& context) noexcept
+    {
+        const auto& inputBlock = context.getInputBlock();
+        auto& outputBlock = context.getOutputBlock();
+        const auto numInChannels = inputBlock.getNumChannels();
+        const auto numOutChannels = outputBlock.getNumChannels();
+        const auto numSamples = (int) outputBlock.getNumSamples();
+
+        jassert(inputBlock.getNumSamples() == outputBlock.getNumSamples());
+        outputBlock.copyFrom(inputBlock);
+
+        if (context.isBypassed)
+            return;
+
+        if (numInChannels == 1 && numOutChannels == 1)
+            processMono(outputBlock.getChannelPointer(0), numSamples);
+        else if (numInChannels == 2 && numOutChannels == 2)
+            processStereo(outputBlock.getChannelPointer(0), outputBlock.getChannelPointer(1), numSamples);
+        else
+            jassertfalse; // invalid channel configuration
+    }
+
+private:
+    //==============================================================================
+    using Lanes = juce::dsp::SIMDRegister<float>;
+
+    // The tank uses four lanes. Wider registers (AVX, when the plugin is built
+    // for it) carry them in their low lanes and leave the rest at zero.
+    static constexpr size_t numLanes = 4;
+    static constexpr size_t registerWidth = Lanes::SIMDNumElements;
+    static constexpr size_t registerAlignment = Lanes::SIMDRegisterSize;
+    static_assert(registerWidth >= numLanes, "The plate tank needs four lanes per register");
+
+    void processStereo(float* left, float* right, int numSamples) noexcept
+    {
+        for (int i = 0; i < numSamples; ++i)
+        {
+            float outL, outR;
+            processSample((left[i] + right[i]) * gain, outL, outR);
+
+            const float wet1 = wetGain1.getNextValue();
+            const float wet2 = wetGain2.getNextValue();
+
+            left[i] = outL * wet1 + outR * wet2;
+            right[i] = outR * wet1 + outL * wet2;
+        }
+
+        renormaliseLfo();
+    }
+
+    void processMono(float* samples, int numSamples) noexcept
+    {
+        for (int i = 0; i < numSamples; ++i)
+        {
+            float outL, outR;
+            processSample(samples[i] * gain, outL, outR);
+
+            samples[i] = 0.5f * (outL + outR) * wetGain1.getNextValue();
+        }
+
+        renormaliseLfo();
+    }
+
+    void processSample(float input, float& outL, float& outR) noexcept
+    {
+        const float damp = damping.getNextValue();
+        const float decayGain = decay.getNextValue();
+
+        bandwidthState += bandwidth * (input - bandwidthState);
+
+        // Input diffusers, pipelined: lane n takes lane n - 1's output from the last sample.
+        alignas(registerAlignment) float diffuserInputs[registerWidth] = { bandwidthState,
+                                                                      diffuserOutputs.get(0),
+                                                                      diffuserOutputs.get(1),
+                                                                      diffuserOutputs.get(2) };
+
+        diffuserOutputs = inputDiffusers.processAllPass(Lanes::fromRawArray(diffuserInputs), inputDiffusion, nullptr);
+        inputDiffusers.advance();
+
+        const float diffused = diffuserOutputs.get(3);
+
+        // Tank. The first allpass of each half takes the input plus the other half's
+        // output; the second takes its own half's damped first delay.
+        const auto delayed = tankDelays.read();
+        dampingState += (delayed - dampingState) * Lanes::expand(1.0f - damp);
+
+        alignas(registerAlignment) float tankInputs[registerWidth] = { diffused + decayGain * delayed.get(3),
+                                                                       diffused + decayGain * delayed.get(2),
+                                                                       decayGain * dampingState.get(0),
+                                                                       decayGain * dampingState.get(1) };
+
+        const float modulation[numLanes] = { lfoY * excursion, lfoX * excursion, 0.0f, 0.0f };
+
+        tankDelays.write(tankAllPasses.processAllPass(Lanes::fromRawArray(tankInputs), decayDiffusion, modulation));
+
+        tankAllPasses.advance();
+        tankDelays.advance();
+
+        const float nextX = lfoX * lfoCos - lfoY * lfoSin;
+        lfoY = lfoY * lfoCos + lfoX * lfoSin;
+        lfoX = nextX;
+
+        outL = gatherTaps(leftTaps, leftTapGains);
+        outR = gatherTaps(rightTaps, rightTapGains);
+    }
+
+    void renormaliseLfo() noexcept
+    {
+        const float scale = 1.0f / std::sqrt(lfoX * lfoX + lfoY * lfoY);
+        lfoX *= scale;
+        lfoY *= scale;
+    }
+
+    void updateDecay() noexcept
+    {
+        const bool frozen = parameters.freezeMode >= 0.5f;
+        gain = frozen ? 0.0f : inputGain;
+
+        if (frozen)
+        {
+            damping.setTargetValue(0.0f);
+            decay.setTargetValue(1.0f);
+        }
+        else
+        {
+            // Each half of the tank applies the decay gain twice per pass. Match one pass to
+            // what Freeverb's average comb loses over the same time, which keeps the size
+            // knob's RT60 comparable between engines.
+            const float combFeedback = parameters.roomSize * 0.28f + 0.7f;
+            const auto passToCombRatio = (float) (halfTankSeconds / (2.0 * referenceCombSeconds));
+
+            damping.setTargetValue(parameters.damping * 0.5f);
+            decay.setTargetValue(std::pow(combFeedback, passToCombRatio));
+        }
+
+        const float decayDiffusion2 = juce::jlimit(0.25f, 0.5f, decay.getTargetValue() + 0.15f);
+        decayDiffusion = makeLanes(-0.7f, -0.7f, decayDiffusion2, decayDiffusion2);
+    }
+
+    static Lanes makeLanes(float a, float b, float c, float d) noexcept
+    {
+        alignas(registerAlignment) const float values[registerWidth] = { a, b, c, d };
+        return Lanes::fromRawArray(values);
+    }
+
+    //==============================================================================
+    enum TapGroup
+    {
+        tankAllPass,
+        tankDelay
+    };
+
+    struct TapSource
+    {
+        TapGroup group;
+        int lane, delay;
+        float sign;
+    };
+
+    struct Tap
+    {
+        TapGroup group = tankDelay;
+        int lane = 0, delay = 1;
+    };
+
+    static constexpr size_t numTapsPerSide = 7;
+    static constexpr size_t numTapRegisters = (numTapsPerSide + registerWidth - 1) / registerWidth;
+    using TapArray = std::array<Tap, numTapsPerSide>;
+    using TapGainArray = std::array<float, numTapRegisters * registerWidth>;
+
+    float gatherTaps(const TapArray& taps, const TapGainArray& tapGains) const noexcept
+    {
+        alignas(registerAlignment) float values[numTapRegisters * registerWidth] = {};
+
+        for (size_t i = 0; i < numTapsPerSide; ++i)
+        {
+            const auto& tap = taps[i];
+            const auto& source = tap.group == tankDelay ? tankDelays : tankAllPasses;
+            values[i] = source.readLane(tap.lane, tap.delay);
+        }
+
+        auto sum = Lanes::expand(0.0f);
+
+        for (size_t r = 0; r < numTapRegisters; ++r)
+            sum += Lanes::fromRawArray(values + r * registerWidth) * Lanes::fromRawArray(tapGains.data() + r * registerWidth);
+
+        return sum.sum();
+    }
+
+    //==============================================================================
+    /** Four interleaved delay lines sharing one write index, one per lane. */
+    class LaneDelay
+    {
+    public:
+        void setLengths(std::array<int, numLanes> newLengths, int maxModulation)
+        {
+            lengths = newLengths;
+
+            const auto longest = *std::max_element(lengths.begin(), lengths.end());
+            buffer.assign((size_t) juce::nextPowerOfTwo(longest + maxModulation + 2), Lanes::expand(0.0f));
+            mask = (int) buffer.size() - 1;
+            writeIndex = 0;
+        }
+
+        void clear() noexcept
+        {
+            std::fill(buffer.begin(), buffer.end(), Lanes::expand(0.0f));
+        }
+
+        size_t getMemoryUsage() const noexcept { return MemoryUsage::bytesOf(buffer); }
+
+        float readLane(int lane, int delay) const noexcept
+        {
+            return rawSamples()[((size_t) ((writeIndex - delay) & mask)) * registerWidth + (size_t) lane];
+        }
+
+        /** Gathers each lane at its own length. */
+        Lanes read() const noexcept
+        {
+            alignas(registerAlignment) float values[registerWidth] = {};
+
+            for (size_t lane = 0; lane < numLanes; ++lane)
+                values[lane] = readLane((int) lane, lengths[lane]);
+
+            return Lanes::fromRawArray(values);
+        }
+
+        /** Gathers each lane at its own length plus a per-lane offset, interpolated. */
+        Lanes read(const float* offsets) const noexcept
+        {
+            alignas(registerAlignment) float earlier[registerWidth] = {}, later[registerWidth] = {}, fractions[registerWidth] = {};
+
+            for (size_t lane = 0; lane < numLanes; ++lane)
+            {
+                const float position = (float) lengths[lane] + offsets[lane];
+                const int whole = (int) position;
+
+                fractions[lane] = position - (float) whole;
+                later[lane] = readLane((int) lane, whole);
+                earlier[lane] = readLane((int) lane, whole + 1);
+            }
+
+            const auto laterLanes = Lanes::fromRawArray(later);
+            return laterLanes + (Lanes::fromRawArray(earlier) - laterLanes) * Lanes::fromRawArray(fractions);
+        }
+
+        void write(Lanes values) noexcept { buffer[(size_t) writeIndex] = values; }
+        void advance() noexcept { writeIndex = (writeIndex + 1) & mask; }
+
+        /** Runs every lane as an allpass over its own delay line, optionally modulated. */
+        Lanes processAllPass(Lanes input, Lanes coefficients, const float* modulation) noexcept
+        {
+            const auto delayedLanes = modulation != nullptr ? read(modulation) : read();
+            const auto w = input - delayedLanes * coefficients;
+
+            write(w);
+            return delayedLanes + w * coefficients;
+        }
+
+    private:
+        const float* rawSamples() const noexcept { return reinterpret_cast<const float*>(buffer.data()); }
+
+        std::vector<Lanes> buffer;
+        std::array<int, numLanes> lengths{};
+        int mask = 0, writeIndex = 0;
+    };
+
+    //==============================================================================
+    static constexpr double dattorroSampleRate = 29761.0;
+    static constexpr double halfTankSeconds = (672 + 4453 + 1800 + 3720 + 908 + 4217 + 2656 + 3163) / (2.0 * 29761.0);
+    static constexpr double referenceCombSeconds = 1378.0 / 44100.0; // mean Freeverb comb length
+    static constexpr double lfoRateHz = 1.0;
+    static constexpr float bandwidth = 0.9995f;
+    static constexpr float inputGain = 0.33f;
+    static constexpr float outputGain = 0.6f;
+
+    Parameters parameters;
+    float gain = inputGain;
+
+    LaneDelay inputDiffusers, tankAllPasses, tankDelays;
+
+    const Lanes inputDiffusion = makeLanes(0.75f, 0.75f, 0.625f, 0.625f);
+    Lanes decayDiffusion = makeLanes(-0.7f, -0.7f, 0.5f, 0.5f);
+    Lanes diffuserOutputs = Lanes::expand(0.0f), dampingState = Lanes::expand(0.0f);
+    float bandwidthState = 0.0f;
+
+    TapArray leftTaps, rightTaps;
+    alignas(registerAlignment) TapGainArray leftTapGains{}, rightTapGains{};
+
+    float excursion = 16.0f;
+    float lfoX = 1.0f, lfoY = 0.0f, lfoCos = 1.0f, lfoSin = 0.0f;
+
+    juce::SmoothedValue<float> damping, decay, wetGain1, wetGain2;
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR(PlateReverb)
+};
@@ -32,6 +32,9 @@ YetiReverbAudioProcessorEditor::YetiReverbAudioProcessorEditor (YetiReverbAudioP
     //widthKnob.setAudioParameter(audioProcessor.apvts, ParamIDs::width);
     //lowshelfKnob.setAudioParameter(audioProcessor.apvts, ParamIDs::lowshelf);
     //highshelfKnob.setAudioParameter(audioProcessor.apvts, ParamIDs::highshelf);
+
+    timerCallback();
+    startTimerHz(10);
 }
 
 YetiReverbAudioProcessorEditor::~YetiReverbAudioProcessorEditor()
@@ -41,7 +44,137 @@ YetiReverbAudioProcessorEditor::~YetiReverbAudioProcessorEditor()
 //==============================================================================
 void YetiReverbAudioProcessorEditor::paint (juce::Graphics& g)
 {
-    g.drawImage(ImageCache::getFromMemory(BinaryData::Base_png, BinaryData::Base_pngSize),getLocalBounds().toFloat());
+    g.drawImage(getScaledBackground(g.getInternalContext().getPhysicalPixelScaleFactor()), getLocalBounds().toFloat());
+
+    paintLoadMeter(g);
+
+    if (memoryText.isNotEmpty())
+    {
+        g.setColour(juce::Colours::black.withAlpha(0.55f));
+        g.setFont(12.0f);
+        g.drawText(memoryText, getMemoryTextBounds(), juce::Justification::centredLeft);
+        g.drawText(latencyText, getLatencyTextBounds(), juce::Justification::centredLeft);
+    }
+}
+
+size_t YetiReverbAudioProcessorEditor::getImageMemoryUsage() const
+{
+    const auto bytesOf = [](const juce::Image& image) -> size_t
+    {
+        if (! image.isValid())
+            return 0;
+
+        const auto bytesPerPixel = image.getFormat() == juce::Image::SingleChannel ? 1
+                                 : image.getFormat() == juce::Image::RGB           ? 3
+                                                                                   : 4;
+        return (size_t) image.getWidth() * (size_t) image.getHeight() * (size_t) bytesPerPixel;
+    };
+
+    auto bytes = bytesOf(scaledBackground);
+
+    for (const auto* knob : { &mixKnob, &dampKnob, &sizeKnob, &widthKnob, &lowshelfKnob, &highshelfKnob })
+        for (const auto& frame : knob->getScaledFrames())
+            bytes += bytesOf(frame.image);
+
+    return bytes;
+}
+
+void YetiReverbAudioProcessorEditor::paintLoadMeter (juce::Graphics& g) const
+{
+    // A bar for the average load with a tick at the peak, which turns red
+    // once a block has come close to missing its deadline.
+    auto bounds = getLoadMeterBounds();
+    auto bar = bounds.removeFromLeft(48).withSizeKeepingCentre(48, 6).toFloat();
+
+    g.setColour(juce::Colours::black.withAlpha(0.12f));
+    g.fillRect(bar);
+
+    g.setColour(juce::Colours::black.withAlpha(0.45f));
+    g.fillRect(bar.withWidth(bar.getWidth() * juce::jlimit(0.0f, 1.0f, averageLoad)));
+
+    const auto peakX = bar.getX() + bar.getWidth() * juce::jlimit(0.0f, 1.0f, peakLoad);
+    g.setColour(peakLoad > 0.8f ? juce::Colours::red : juce::Colours::black.withAlpha(0.7f));
+    g.fillRect(juce::Rectangle<float>(peakX - 1.0f, bar.getY() - 2.0f, 2.0f, bar.getHeight() + 4.0f));
+
+    g.setColour(juce::Colours::black.withAlpha(0.55f));
+    g.setFont(12.0f);
+    g.drawText(loadText, bounds.withTrimmedLeft(6), juce::Justification::centredLeft);
+}
+
+const juce::Image& YetiReverbAudioProcessorEditor::getScaledBackground(float scale)
+{
+    const auto width = juce::jmax(1, juce::roundToInt((float) getWidth() * scale));
+    const auto height = juce::jmax(1, juce::roundToInt((float) getHeight() * scale));
+
+    if (scaledBackground.getWidth() != width || scaledBackground.getHeight() != height)
+        scaledBackground = ImageCache::getFromMemory(BinaryData::Base_png, BinaryData::Base_pngSize).rescaled(width, height);
+
+    return scaledBackground;
+}
+
+juce::Rectangle<int> YetiReverbAudioProcessorEditor::getLoadMeterBounds() const
+{
+    return { 12, getHeight() - 22, 170, 16 };
+}
+
+juce::Rectangle<int> YetiReverbAudioProcessorEditor::getMemoryTextBounds() const
+{
+    return { getLoadMeterBounds().getRight() + 8, getHeight() - 22, 250, 16 };
+}
+
+juce::Rectangle<int> YetiReverbAudioProcessorEditor::getLatencyTextBounds() const
+{
+    return getLoadMeterBounds().withY(getHeight() - 38).withWidth(428);
+}
+
+void YetiReverbAudioProcessorEditor::timerCallback()
+{
+    const auto& loadMeter = audioProcessor.getLoadMeter();
+    const auto newAverage = loadMeter.getAverageLoad();
+    const auto newPeak = loadMeter.getPeakLoad();
+
+    // Only repaint when what's drawn would change.
+    const auto bucket = [](float load) { return juce::roundToInt(load * 1000.0f); };
+
+    if (bucket(newAverage) != bucket(averageLoad) || bucket(newPeak) != bucket(peakLoad) || loadText.isEmpty())
+    {
+        averageLoad = newAverage;
+        peakLoad = newPeak;
+        loadText = "DSP " + juce::String(averageLoad * 100.0f, 1) + "%, peak " + juce::String(peakLoad * 100.0f, 1) + "%";
+        repaint(getLoadMeterBounds());
+    }
+
+    if (audioProcessor.wrapperType != juce::AudioProcessor::wrapperType_Standalone)
+        return;
+
+    const auto dsp = audioProcessor.getMemoryUsage().getTotal();
+    const auto text = "Memory: " + juce::File::descriptionOfSizeInBytes((juce::int64) dsp) + " DSP, "
+                    + juce::File::descriptionOfSizeInBytes((juce::int64) getImageMemoryUsage()) + " GUI";
+
+    if (text != memoryText)
+    {
+        memoryText = text;
+        repaint(getMemoryTextBounds());
+    }
+
+    // The tail of the block times since the audio device started, as shares
+    // of each block's deadline.
+    const auto statistics = loadMeter.getStatistics();
+    const auto percent = [](float load) { return juce::String(load * 100.0f, 1) + "%"; };
+
+    const auto latency = "p50 " + percent(statistics.getPercentile(0.5))
+                       + ", p99 " + percent(statistics.getPercentile(0.99))
+                       + ", p99.9 " + percent(statistics.getPercentile(0.999))
+                       + ", jitter " + percent(statistics.getJitter())
+                       + ", over 50/80/100%: " + juce::String(statistics.over50)
+                       + "/" + juce::String(statistics.over80)
+                       + "/" + juce::String(statistics.overDeadline);
+
+    if (latency != latencyText)
+    {
+        latencyText = latency;
+        repaint(getLatencyTextBounds());
+    }
 }
 
 void YetiReverbAudioProcessorEditor::resized()
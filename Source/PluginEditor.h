@@ -15,7 +15,8 @@
 //==============================================================================
 /**
 */
-class YetiReverbAudioProcessorEditor  : public juce::AudioProcessorEditor
+class YetiReverbAudioProcessorEditor  : public juce::AudioProcessorEditor,
+                                        private juce::Timer
 {
 public:
     YetiReverbAudioProcessorEditor (YetiReverbAudioProcessor&);
@@ -25,12 +26,34 @@ public:
     void paint (juce::Graphics&) override;
     void resized() override;
 
+    /** The bytes held by the decoded images this editor draws. */
+    size_t getImageMemoryUsage() const;
+
 private:
+    void timerCallback() override;
+    void paintLoadMeter (juce::Graphics&) const;
+    juce::Rectangle<int> getLoadMeterBounds() const;
+    juce::Rectangle<int> getMemoryTextBounds() const;
+    juce::Rectangle<int> getLatencyTextBounds() const;
+    const juce::Image& getScaledBackground(float scale);
+
     // This reference is provided as a quick way for your editor to
     // access the processor object that created it.
     YetiReverbAudioProcessor& audioProcessor;
 
     ImageKnob mixKnob, dampKnob, sizeKnob, widthKnob, lowshelfKnob, highshelfKnob;
 
+    // The background is drawn at four times the editor's size. It's scaled to
+    // the display once, rather than resampled on every paint, and the full
+    // size one is left to the ImageCache to let go of.
+    juce::Image scaledBackground;
+
+    // The processor's DSP load, as last shown.
+    float averageLoad = 0.0f, peakLoad = 0.0f;
+    juce::String loadText;
+
+    // Only shown in the standalone app.
+    juce::String memoryText, latencyText;
+
     JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR (YetiReverbAudioProcessorEditor)
 };
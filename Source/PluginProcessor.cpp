@@ -10,16 +10,29 @@
 #include "PluginEditor.h"
 
 //==============================================================================
+#ifndef JucePlugin_PreferredChannelConfigurations
+juce::AudioProcessor::BusesProperties YetiReverbAudioProcessor::createBusesProperties()
+{
+    auto buses = BusesProperties()
+                 #if ! JucePlugin_IsMidiEffect
+                  #if ! JucePlugin_IsSynth
+                   .withInput  ("Input",  juce::AudioChannelSet::stereo(), true)
+                  #endif
+                   .withOutput ("Output", juce::AudioChannelSet::stereo(), true)
+                 #endif
+                   ;
+
+    // Optional sidechain inputs, so several sources can share one reverb.
+    for (int send = 0; send < maxSendBuses; ++send)
+        buses = buses.withInput ("Send " + juce::String (send + 1), juce::AudioChannelSet::stereo(), false);
+
+    return buses;
+}
+#endif
+
 YetiReverbAudioProcessor::YetiReverbAudioProcessor()
 #ifndef JucePlugin_PreferredChannelConfigurations
-     : AudioProcessor (BusesProperties()
-                     #if ! JucePlugin_IsMidiEffect
-                      #if ! JucePlugin_IsSynth
-                       .withInput  ("Input",  juce::AudioChannelSet::stereo(), true)
-                      #endif
-                       .withOutput ("Output", juce::AudioChannelSet::stereo(), true)
-                     #endif
-                       ),
+     : AudioProcessor (createBusesProperties()),
 #endif
     apvts(*this, nullptr, "Parameters", createParameterLayout())
 {
@@ -30,6 +43,24 @@ YetiReverbAudioProcessor::YetiReverbAudioProcessor()
     mixParam = apvts.getRawParameterValue(ParamIDs::mix);
     lowShelfFreqParam = apvts.getRawParameterValue(ParamIDs::lowshelf);
     highShelfFreqParam = apvts.getRawParameterValue(ParamIDs::highshelf);
+    algorithmParam = apvts.getRawParameterValue(ParamIDs::algorithm);
+    earlyLevelParam = apvts.getRawParameterValue(ParamIDs::earlyLevel);
+    earlyTapsParam = apvts.getRawParameterValue(ParamIDs::earlyTaps);
+    multibandParam = apvts.getRawParameterValue(ParamIDs::multiband);
+    bandDecayParams = { apvts.getRawParameterValue(ParamIDs::lowDecay),
+                        apvts.getRawParameterValue(ParamIDs::lowMidDecay),
+                        apvts.getRawParameterValue(ParamIDs::highMidDecay),
+                        apvts.getRawParameterValue(ParamIDs::highDecay) };
+    warmthParam = apvts.getRawParameterValue(ParamIDs::warmth);
+    modulationParam = apvts.getRawParameterValue(ParamIDs::modulation);
+    shimmerParam = apvts.getRawParameterValue(ParamIDs::shimmer);
+    qualityParam = apvts.getRawParameterValue(ParamIDs::quality);
+    adaptiveQualityParam = apvts.getRawParameterValue(ParamIDs::adaptiveQuality);
+
+    for (int send = 0; send < maxSendBuses; ++send)
+        sendLevelParams[(size_t) send] = apvts.getRawParameterValue(ParamIDs::sendLevel(send));
+
+    bypassParam = apvts.getRawParameterValue(ParamIDs::bypass);
 
 }
 
@@ -72,7 +103,28 @@ bool YetiReverbAudioProcessor::isMidiEffect() const
 
 double YetiReverbAudioProcessor::getTailLengthSeconds() const
 {
-    return 0.0;
+    // Hosts ask from the message thread, so this works from the parameters
+    // rather than from the engines the audio thread is updating. The early
+    // reflections all arrive well within the late tail.
+    juce::Reverb::Parameters current;
+    current.roomSize = sizeParam->load();
+
+    switch (getSelectedAlgorithm())
+    {
+        case ReverbAlgorithm::velvet: return VelvetReverb::getDecaySeconds(current);
+        case ReverbAlgorithm::plate:  return PlateReverb::getDecaySeconds(current);
+        case ReverbAlgorithm::multiband:
+        {
+            MultibandReverb::BandDecays decays;
+
+            for (size_t band = 0; band < decays.size(); ++band)
+                decays[band] = bandDecayParams[band]->load();
+
+            return MultibandReverb::getDecaySeconds(current, decays);
+        }
+        case ReverbAlgorithm::freeverb:
+        default:                      return TieredFreeverb::getDecaySeconds(current);
+    }
 }
 
 int YetiReverbAudioProcessor::getNumPrograms()
@@ -109,19 +161,73 @@ void YetiReverbAudioProcessor::prepareToPlay (double sampleRate, int samplesPerB
 
     spec.sampleRate = sampleRate;
     spec.maximumBlockSize = static_cast<juce::uint32> (samplesPerBlock);
-    spec.numChannels = static_cast<juce::uint32> (getTotalNumOutputChannels());
+    spec.numChannels = static_cast<juce::uint32> (getMainBusNumOutputChannels());
+
+    sendBusesActive = false;
+
+    for (int bus = 1; bus < getBusCount (true); ++bus)
+        sendBusesActive = sendBusesActive || getChannelCountOfBus (true, bus) > 0;
 
-    reverb.prepare(spec);
+    maxBlockSize = samplesPerBlock;
+    dryBuffer.setSize (getMainBusNumOutputChannels(), samplesPerBlock);
+    bypassDryBuffer.setSize (getMainBusNumOutputChannels(), samplesPerBlock);
+    outputChain.prepare(sampleRate);
 
-    leftLowShelfFilter.reset();
-    rightLowShelfFilter.reset();
-    leftHighShelfFilter.reset();
-    rightHighShelfFilter.reset();
+    for (int send = 0; send < maxSendBuses; ++send)
+        lastSendGains[(size_t) send] = sendLevelParams[(size_t) send]->load();
 
-    leftLowShelfFilter.prepare(spec);
-    rightLowShelfFilter.prepare(spec);
-    leftHighShelfFilter.prepare(spec);
-    rightHighShelfFilter.prepare(spec);
+    // Pick the tier before preparing, so an offline render starts at High
+    // rather than crossfading into it.
+    adaptiveQuality.prepare(sampleRate);
+    loadMeter.prepare(sampleRate, samplesPerBlock);
+    updateQuality();
+
+    // Push the current parameters first. The engines start their smoothing from
+    // them, and the initial early-reflection design matches the current room.
+    updateReverbParams();
+
+    velvetReverb.prepare(spec);
+    plateReverb.prepare(spec);
+    multibandReverb.prepare(spec);
+    earlyReflections.prepare(spec);
+
+    // The other engines are always there, so the Freeverb tiers get whatever
+    // the budget has left after them.
+    MemoryUsage usage;
+    usage.objects = sizeof(*this);
+    usage.blockBuffers = MemoryUsage::bytesOf(dryBuffer) + MemoryUsage::bytesOf(bypassDryBuffer);
+    velvetReverb.addMemoryUsage(usage);
+    plateReverb.addMemoryUsage(usage);
+    multibandReverb.addMemoryUsage(usage);
+    earlyReflections.addMemoryUsage(usage);
+
+    const auto budget = memoryBudget.load();
+
+    if (budget == 0)
+        reverb.prepare(spec);
+    else
+        reverb.prepare(spec, budget > usage.getTotal() ? budget - usage.getTotal() : 0);
+
+    usage += reverb.getMemoryUsage();
+
+    {
+        const juce::ScopedLock sl(memoryUsageLock);
+        memoryUsage = usage;
+    }
+
+    outputChain.reset();
+
+    // Everything has just been cleared, so there's no tail to let ring out.
+    bypassed = bypassParam->load() >= 0.5f;
+    tailRinging = false;
+    silentTailSamples = 0;
+    tailHoldSamples = (int) std::ceil(tailHoldSeconds * sampleRate);
+}
+
+MemoryUsage YetiReverbAudioProcessor::getMemoryUsage() const
+{
+    const juce::ScopedLock sl(memoryUsageLock);
+    return memoryUsage;
 }
 
 void YetiReverbAudioProcessor::releaseResources()
@@ -130,6 +236,18 @@ void YetiReverbAudioProcessor::releaseResources()
     // spare memory, etc.
 }
 
+void YetiReverbAudioProcessor::setNonRealtime (bool isNonRealtime) noexcept
+{
+    AudioProcessor::setNonRealtime (isNonRealtime);
+
+    // The left and right reverb channels can only share the work with a second
+    // thread when the audio thread is allowed to block, i.e. during bounces.
+    if (isNonRealtime)
+        renderWorker.start();
+    else
+        renderWorker.stop();
+}
+
 #ifndef JucePlugin_PreferredChannelConfigurations
 bool YetiReverbAudioProcessor::isBusesLayoutSupported (const BusesLayout& layouts) const
 {
@@ -151,14 +269,66 @@ bool YetiReverbAudioProcessor::isBusesLayoutSupported (const BusesLayout& layout
         return false;
    #endif
 
+    // Each send can be off, mono or stereo.
+    for (int bus = 1; bus < layouts.inputBuses.size(); ++bus)
+    {
+        const auto& send = layouts.getChannelSet (true, bus);
+
+        if (! send.isDisabled()
+         && send != juce::AudioChannelSet::mono()
+         && send != juce::AudioChannelSet::stereo())
+            return false;
+    }
+
     return true;
   #endif
 }
 #endif
 
 void YetiReverbAudioProcessor::processBlock (juce::AudioBuffer<float>& buffer, juce::MidiBuffer& midiMessages)
+{
+    juce::ignoreUnused (midiMessages);
+    processInChunks(buffer, bypassParam->load() >= 0.5f);
+}
+
+void YetiReverbAudioProcessor::processBlockBypassed (juce::AudioBuffer<float>& buffer, juce::MidiBuffer& midiMessages)
+{
+    // Only called by hosts that bypass without going through the parameter.
+    juce::ignoreUnused (midiMessages);
+    processInChunks(buffer, true);
+}
+
+void YetiReverbAudioProcessor::processInChunks (juce::AudioBuffer<float>& buffer, bool shouldBypass)
+{
+    const auto numSamples = buffer.getNumSamples();
+
+    if (numSamples <= maxBlockSize || maxBlockSize <= 0)
+    {
+        process(buffer, shouldBypass);
+        return;
+    }
+
+    // A block larger than announced is processed a prepared size at a time.
+    // The chunks refer to the host's channels, which needs no allocation for
+    // up to 32 of them.
+    for (int start = 0; start < numSamples; start += maxBlockSize)
+    {
+        juce::AudioBuffer<float> chunk(buffer.getArrayOfWritePointers(), buffer.getNumChannels(),
+                                       start, juce::jmin(maxBlockSize, numSamples - start));
+        process(chunk, shouldBypass);
+    }
+}
+
+juce::AudioProcessorParameter* YetiReverbAudioProcessor::getBypassParameter() const
+{
+    return apvts.getParameter(ParamIDs::bypass);
+}
+
+void YetiReverbAudioProcessor::process (juce::AudioBuffer<float>& buffer, bool shouldBypass)
 {
     juce::ScopedNoDenormals noDenormals;
+    YETI_TRACE_SCOPE(tracer, TraceStage::processBlock);
+    DspLoadMeter::ScopedTimer loadTimer(loadMeter, buffer.getNumSamples(), ! isNonRealtime());
     auto totalNumInputChannels  = getTotalNumInputChannels();
     auto totalNumOutputChannels = getTotalNumOutputChannels();
 
@@ -171,26 +341,152 @@ void YetiReverbAudioProcessor::processBlock (juce::AudioBuffer<float>& buffer, j
     for (auto i = totalNumInputChannels; i < totalNumOutputChannels; ++i)
         buffer.clear (i, 0, buffer.getNumSamples());
 
-    updateReverbParams();
-    updateFilterCoefficients();
-
-    juce::dsp::AudioBlock<float> block(buffer);
+    // Bypassed with the tail gone: the input passes straight through.
+    if (shouldBypass && bypassed && ! tailRinging)
+        return;
+
+    {
+        YETI_TRACE_SCOPE(tracer, TraceStage::parameters);
+        updateAlgorithm();
+        updateQuality();
+        updateReverbParams();
+    }
+
+    {
+        YETI_TRACE_SCOPE(tracer, TraceStage::coefficients);
+        updateFilterCoefficients();
+    }
+
+    auto mainBuffer = getBusBuffer(buffer, false, 0);
+    const auto numSamples = mainBuffer.getNumSamples();
+    const auto numChannels = mainBuffer.getNumChannels();
+
+    // How much input reaches the reverb at the start and end of this block.
+    // A change of bypass state crossfades over the block.
+    const auto startGain = bypassed ? 0.0f : 1.0f;
+    const auto endGain = shouldBypass ? 0.0f : 1.0f;
+    const auto tailOnly = bypassed && shouldBypass;
+
+    if (bypassed || shouldBypass)
+    {
+        jassert(numSamples <= bypassDryBuffer.getNumSamples());
+
+        for (int channel = 0; channel < numChannels; ++channel)
+            bypassDryBuffer.copyFrom(channel, 0, mainBuffer, channel, 0, numSamples);
+    }
+
+    if (tailOnly)
+    {
+        // The cheap path: nothing new goes in, so there's no dry signal or
+        // sends to mix, and the reverb just runs on with silence.
+        mainBuffer.clear();
+    }
+    else
+    {
+        YETI_TRACE_SCOPE(tracer, TraceStage::input);
+
+        if (outputChain.needsDry())
+        {
+            jassert(numSamples <= dryBuffer.getNumSamples());
+
+            for (int channel = 0; channel < numChannels; ++channel)
+                dryBuffer.copyFrom(channel, 0, mainBuffer, channel, 0, numSamples);
+        }
+
+        if (sendBusesActive)
+            mixSendBuses(buffer, mainBuffer);
+
+        if (bypassed != shouldBypass)
+        {
+            mainBuffer.applyGainRamp(0, numSamples, startGain, endGain);
+
+            if (outputChain.needsDry())
+                for (int channel = 0; channel < numChannels; ++channel)
+                    dryBuffer.applyGainRamp(channel, 0, numSamples, startGain, endGain);
+        }
+    }
+
+    juce::dsp::AudioBlock<float> block(mainBuffer);
     juce::dsp::ProcessContextReplacing<float> ctx(block);
 
-    reverb.process(ctx);
-
-    auto leftChannelBlock = block.getSingleChannelBlock(0);
-    auto rightChannelBlock = block.getSingleChannelBlock(1);
-
-    juce::dsp::ProcessContextReplacing<float> leftContext(leftChannelBlock);
-    juce::dsp::ProcessContextReplacing<float> rightContext(rightChannelBlock);
-
-    leftLowShelfFilter.process(leftContext);
-    rightLowShelfFilter.process(rightContext);
-
-    leftHighShelfFilter.process(leftContext);
-    rightHighShelfFilter.process(rightContext);
+    earlyReflections.pushInput(block);
+
+    {
+        YETI_TRACE_SCOPE(tracer, TraceStage::reverb);
+
+        switch (algorithm)
+        {
+            case ReverbAlgorithm::velvet: velvetReverb.process(ctx); break;
+            case ReverbAlgorithm::plate:  plateReverb.process(ctx);  break;
+            case ReverbAlgorithm::multiband: multibandReverb.process(ctx); break;
+            case ReverbAlgorithm::freeverb:
+            default:                      reverb.process(ctx);       break;
+        }
+    }
+
+    if (earlyReflections.isActive())
+    {
+        YETI_TRACE_SCOPE(tracer, TraceStage::earlyReflections);
+        earlyReflections.addTo(block);
+    }
+
+    {
+        YETI_TRACE_SCOPE(tracer, TraceStage::outputChain);
+
+        if (tailOnly)
+        {
+            outputChain.processWet(block);
+
+            if (mainBuffer.getMagnitude(0, numSamples) < silentTailLevel)
+                silentTailSamples += numSamples;
+            else
+                silentTailSamples = 0;
+
+            if (silentTailSamples >= tailHoldSamples)
+                stopReverb();
+        }
+        else
+        {
+            outputChain.process(block, dryBuffer);
+        }
+    }
+
+    if (bypassed || shouldBypass)
+    {
+        for (int channel = 0; channel < numChannels; ++channel)
+            kernels.addWithRamp(mainBuffer.getWritePointer(channel), bypassDryBuffer.getReadPointer(channel),
+                                1.0f - startGain, 1.0f - endGain, numSamples);
+    }
+
+    if (shouldBypass && ! bypassed)
+    {
+        tailRinging = true;
+        silentTailSamples = 0;
+    }
+
+    const auto wasBypassed = std::exchange(bypassed, shouldBypass);
+    const auto seconds = loadTimer.stop();
+
+    // The tail's path costs less than the real one, and the other engines don't
+    // have tiers, so only Freeverb's full path says anything about the tier.
+    if (adaptiveQualityParam->load() >= 0.5f && ! isNonRealtime() && ! wasBypassed && ! shouldBypass
+         && algorithm == ReverbAlgorithm::freeverb)
+    {
+        adaptiveQuality.addMeasurement(seconds, buffer.getNumSamples(), reverb.getQuality(), reverb.isCrossfading());
+    }
+}
 
+void YetiReverbAudioProcessor::stopReverb()
+{
+    reverb.reset();
+    velvetReverb.reset();
+    plateReverb.reset();
+    multibandReverb.reset();
+    earlyReflections.reset();
+    outputChain.reset();
+
+    tailRinging = false;
+    silentTailSamples = 0;
 }
 
 //==============================================================================
@@ -207,15 +503,18 @@ juce::AudioProcessorEditor* YetiReverbAudioProcessor::createEditor()
 //==============================================================================
 void YetiReverbAudioProcessor::getStateInformation (juce::MemoryBlock& destData)
 {
-    // You should use this method to store your parameters in the memory block.
-    // You could do that either as raw data, or use the XML or ValueTree classes
-    // as intermediaries to make it easy to save and load complex data.
+    if (const auto xml = apvts.copyState().createXml())
+        copyXmlToBinary(*xml, destData);
 }
 
 void YetiReverbAudioProcessor::setStateInformation (const void* data, int sizeInBytes)
 {
-    // You should use this method to restore your parameters from this memory block,
-    // whose contents will have been created by the getStateInformation() call.
+    // This has to be called on the message thread: replaceState isn't safe
+    // against the APVTS's timer, which flushes parameter changes into the same
+    // ValueTree there. Audio can keep running while it does, since the audio
+    // thread only reads the parameters' atomics.
+    if (const auto xml = getXmlFromBinary(data, sizeInBytes); xml != nullptr && xml->hasTagName(apvts.state.getType()))
+        apvts.replaceState(juce::ValueTree::fromXml(*xml));
 }
 
 void YetiReverbAudioProcessor::updateReverbParams()
@@ -224,9 +523,131 @@ void YetiReverbAudioProcessor::updateReverbParams()
     params.damping = dampParam->load();
     params.width = widthParam->load();
     params.wetLevel = mixParam->load();
-    params.dryLevel = 1.0f - mixParam->load();
+    outputChain.setDryGain((1.0f - mixParam->load()) * 2.0f);
+
+    switch (algorithm)
+    {
+        case ReverbAlgorithm::velvet: velvetReverb.setParameters(params); break;
+        case ReverbAlgorithm::plate:  plateReverb.setParameters(params);  break;
+        case ReverbAlgorithm::multiband:
+        {
+            MultibandReverb::BandDecays decays;
+
+            for (size_t band = 0; band < decays.size(); ++band)
+                decays[band] = bandDecayParams[band]->load();
+
+            multibandReverb.setBandDecays(decays);
+            multibandReverb.setParameters(params);
+            break;
+        }
+        case ReverbAlgorithm::freeverb:
+        default:
+            reverb.setWarmth(warmthParam->load());
+            reverb.setModulation(modulationParam->load());
+            reverb.setShimmer(shimmerParam->load());
+            reverb.setParameters(params);
+            break;
+    }
+
+    earlyReflections.setRoom(params.roomSize, params.damping, juce::roundToInt(earlyTapsParam->load()));
+    earlyReflections.setLevel(earlyLevelParam->load() * params.wetLevel);
+}
 
-    reverb.setParameters(params);
+ReverbAlgorithm YetiReverbAudioProcessor::getSelectedAlgorithm() const noexcept
+{
+    const auto selected = static_cast<ReverbAlgorithm>(juce::roundToInt(algorithmParam->load()));
+
+    if (selected == ReverbAlgorithm::freeverb && multibandParam->load() >= 0.5f)
+        return ReverbAlgorithm::multiband;
+
+    return selected;
+}
+
+void YetiReverbAudioProcessor::updateAlgorithm()
+{
+    const auto newAlgorithm = getSelectedAlgorithm();
+
+    if (newAlgorithm == algorithm)
+        return;
+
+    algorithm = newAlgorithm;
+
+    // The adaptive cap was measured on the outgoing engine. Freeverb picks its
+    // tier before the reset below, so it starts on it instead of fading into it.
+    adaptiveQuality.reset();
+    updateQuality();
+
+    // Start the incoming engine from silence rather than replaying whatever tail
+    // it was holding the last time it was selected.
+    switch (newAlgorithm)
+    {
+        case ReverbAlgorithm::velvet: velvetReverb.reset(); break;
+        case ReverbAlgorithm::plate:  plateReverb.reset();  break;
+        case ReverbAlgorithm::multiband: multibandReverb.reset(); break;
+        case ReverbAlgorithm::freeverb:
+        default:                      reverb.reset();       break;
+    }
+}
+
+void YetiReverbAudioProcessor::mixSendBuses(juce::AudioBuffer<float>& buffer, juce::AudioBuffer<float>& mainBuffer)
+{
+    const auto numSamples = mainBuffer.getNumSamples();
+    const auto numMainChannels = mainBuffer.getNumChannels();
+    const auto numSends = juce::jmin(maxSendBuses, getBusCount(true) - 1);
+
+    for (int send = 0; send < numSends; ++send)
+    {
+        const auto sendBuffer = getBusBuffer(buffer, true, send + 1);
+        const auto gain = sendLevelParams[(size_t) send]->load();
+        auto& lastGain = lastSendGains[(size_t) send];
+
+        // Mono sends feed both channels. A stereo send into a mono main bus is
+        // folded down.
+        const auto numSendChannels = sendBuffer.getNumChannels();
+        const auto foldDown = numMainChannels == 1 && numSendChannels > 1 ? 0.5f : 1.0f;
+
+        for (int channel = 0; channel < numMainChannels; ++channel)
+            for (int source = channel; source < numSendChannels; source += numMainChannels)
+                kernels.addWithRamp(mainBuffer.getWritePointer(channel), sendBuffer.getReadPointer(source), lastGain * foldDown, gain * foldDown, numSamples);
+
+        if (numSendChannels == 1)
+            for (int channel = 1; channel < numMainChannels; ++channel)
+                kernels.addWithRamp(mainBuffer.getWritePointer(channel), sendBuffer.getReadPointer(0), lastGain, gain, numSamples);
+
+        lastGain = gain;
+    }
+}
+
+void YetiReverbAudioProcessor::updateQuality()
+{
+    // Only Freeverb has tiers. A tier asked for while another engine runs would
+    // wait for a crossfade that never gets processed.
+    if (algorithm != ReverbAlgorithm::freeverb)
+        return;
+
+    // Offline bounces are not CPU-bound, so they always get the best tier.
+    if (isNonRealtime())
+    {
+        reverb.setRenderWorker(renderWorker.isRunning() ? &renderWorker : nullptr);
+        reverb.setQuality(ReverbQuality::high);
+        return;
+    }
+
+    reverb.setRenderWorker(nullptr);
+
+    const auto selected = static_cast<ReverbQuality>(juce::roundToInt(qualityParam->load()));
+
+    // Under CPU pressure, the adaptive cap can take the tier below the one
+    // selected, but never above it.
+    if (adaptiveQualityParam->load() >= 0.5f)
+    {
+        reverb.setQuality(adaptiveQuality.limit(selected));
+    }
+    else
+    {
+        adaptiveQuality.reset();
+        reverb.setQuality(selected);
+    }
 }
 
 void YetiReverbAudioProcessor::updateFilterCoefficients()
@@ -235,14 +656,16 @@ void YetiReverbAudioProcessor::updateFilterCoefficients()
     auto lowShelfGain = juce::Decibels::decibelsToGain(-24.f);
     auto highShelfGain = juce::Decibels::decibelsToGain(-24.f);
 
-    juce::dsp::IIR::Coefficients<float>::Ptr lowShelfCoefficients = juce::dsp::IIR::Coefficients<float>::makeLowShelf(sampleRate, lowShelfFreqParam->load(), 0.707f, lowShelfGain);
-    juce::dsp::IIR::Coefficients<float>::Ptr highShelfCoefficients = juce::dsp::IIR::Coefficients<float>::makeHighShelf(sampleRate, highShelfFreqParam->load(), 0.707f, highShelfGain);
+    // This runs every block, so it uses ArrayCoefficients. IIR::Coefficients
+    // would allocate on the audio thread.
+    using Coefficients = juce::dsp::IIR::ArrayCoefficients<float>;
 
-    leftLowShelfFilter.coefficients = lowShelfCoefficients;
-    rightLowShelfFilter.coefficients = lowShelfCoefficients;
+    // The shelves' ranges reach 20 kHz, which is past Nyquist at 22.05 kHz and
+    // would make the filters unstable, so they stop short of it.
+    const auto maxFrequency = (float) sampleRate * 0.45f;
 
-    leftHighShelfFilter.coefficients = highShelfCoefficients;
-    rightHighShelfFilter.coefficients = highShelfCoefficients;
+    outputChain.setShelves(Coefficients::makeLowShelf(sampleRate, juce::jmin(lowShelfFreqParam->load(), maxFrequency), 0.707f, lowShelfGain),
+                           Coefficients::makeHighShelf(sampleRate, juce::jmin(highShelfFreqParam->load(), maxFrequency), 0.707f, highShelfGain));
 }
 
 //==============================================================================
@@ -9,6 +9,15 @@
 #pragma once
 
 #include <JuceHeader.h>
+#include "VelvetReverb.h"
+#include "PlateReverb.h"
+#include "EarlyReflections.h"
+#include "MultibandReverb.h"
+#include "TieredFreeverb.h"
+#include "AdaptiveQuality.h"
+#include "OutputChain.h"
+#include "DspLoadMeter.h"
+#include "StageTracer.h"
 
 namespace ParamIDs
 {
@@ -19,10 +28,38 @@ namespace ParamIDs
     inline constexpr auto mix{ "mix" };
     inline constexpr auto lowshelf{ "lowshelf" };
     inline constexpr auto highshelf{ "highshelf" };
+    inline constexpr auto algorithm{ "algorithm" };
+    inline constexpr auto earlyLevel{ "earlylevel" };
+    inline constexpr auto earlyTaps{ "earlytaps" };
+    inline constexpr auto multiband{ "multiband" };
+    inline constexpr auto lowDecay{ "lowdecay" };
+    inline constexpr auto lowMidDecay{ "lowmiddecay" };
+    inline constexpr auto highMidDecay{ "highmiddecay" };
+    inline constexpr auto highDecay{ "highdecay" };
+    inline constexpr auto warmth{ "warmth" };
+    inline constexpr auto modulation{ "modulation" };
+    inline constexpr auto shimmer{ "shimmer" };
+    inline constexpr auto quality{ "quality" };
+    inline constexpr auto adaptiveQuality{ "adaptivequality" };
+    inline constexpr auto bypass{ "bypass" };
+
+    /** The send level of sidechain input bus sendIndex + 1. */
+    inline juce::String sendLevel(int sendIndex) { return "sendlevel" + juce::String(sendIndex + 1); }
 
 } // namespace ParamIDs
 
-static juce::AudioProcessorValueTreeState::ParameterLayout createParameterLayout()
+/** How many optional stereo send buses feed the reverb alongside the main input. */
+inline constexpr int maxSendBuses = 8;
+
+enum class ReverbAlgorithm
+{
+    freeverb,
+    velvet,
+    plate,
+    multiband   // Freeverb with per-band decay; selected by the multiband switch
+};
+
+inline juce::AudioProcessorValueTreeState::ParameterLayout createParameterLayout()
 {
     juce::AudioProcessorValueTreeState::ParameterLayout layout;
 
@@ -37,10 +74,17 @@ static juce::AudioProcessorValueTreeState::ParameterLayout createParameterLayout
         return juce::String(value, 1) + " Hz"; // Format value as Hz
     };
 
+    auto ratioFormat = [](float value, int /*maximumStringLength*/)
+    {
+        return juce::String(value, 2) + " x"; // Format as a multiple of the room's decay
+    };
+
 
     juce::NormalisableRange<float> range(0.0f, 1.0f, 0.01f, 1.0f);
     juce::NormalisableRange<float> lowshelfRange(20.0f, 1000.0f, 1.0f, 0.5f);
     juce::NormalisableRange<float> highshelfRange(1000.0f, 20000.0f, 1.0f, 0.5f);
+    juce::NormalisableRange<float> decayRange(0.25f, 4.0f, 0.01f);
+    decayRange.setSkewForCentre(1.0f);
 
     layout.add(std::make_unique<juce::AudioParameterFloat>(
         ParamIDs::size,
@@ -108,6 +152,125 @@ static juce::AudioProcessorValueTreeState::ParameterLayout createParameterLayout
         nullptr
     ));
 
+    layout.add(std::make_unique<juce::AudioParameterChoice>(
+        ParamIDs::algorithm,
+        "Algorithm",
+        juce::StringArray { "Freeverb", "Velvet", "Plate" },
+        0
+    ));
+
+    layout.add(std::make_unique<juce::AudioParameterFloat>(
+        ParamIDs::earlyLevel,
+        "Early Reflections",
+        range,
+        0.0f,
+        juce::String(),
+        juce::AudioProcessorParameter::genericParameter,
+        percentFormat,
+        nullptr
+    ));
+
+    layout.add(std::make_unique<juce::AudioParameterInt>(
+        ParamIDs::earlyTaps,
+        "Early Taps",
+        EarlyReflections::minTaps,
+        EarlyReflections::maxTaps,
+        32
+    ));
+
+    layout.add(std::make_unique<juce::AudioParameterBool>(
+        ParamIDs::multiband,
+        "Multiband Decay",
+        false
+    ));
+
+    const std::pair<const char*, const char*> bandDecays[] = {
+        { ParamIDs::lowDecay,     "Low Decay" },
+        { ParamIDs::lowMidDecay,  "Low-Mid Decay" },
+        { ParamIDs::highMidDecay, "High-Mid Decay" },
+        { ParamIDs::highDecay,    "High Decay" }
+    };
+
+    for (const auto& [id, name] : bandDecays)
+    {
+        layout.add(std::make_unique<juce::AudioParameterFloat>(
+            id,
+            name,
+            decayRange,
+            1.0f,
+            juce::String(),
+            juce::AudioProcessorParameter::genericParameter,
+            ratioFormat,
+            nullptr
+        ));
+    }
+
+    layout.add(std::make_unique<juce::AudioParameterFloat>(
+        ParamIDs::warmth,
+        "Warmth",
+        range,
+        0.0f,
+        juce::String(),
+        juce::AudioProcessorParameter::genericParameter,
+        percentFormat,
+        nullptr
+    ));
+
+    layout.add(std::make_unique<juce::AudioParameterFloat>(
+        ParamIDs::modulation,
+        "Modulation",
+        range,
+        0.0f,
+        juce::String(),
+        juce::AudioProcessorParameter::genericParameter,
+        percentFormat,
+        nullptr
+    ));
+
+    layout.add(std::make_unique<juce::AudioParameterFloat>(
+        ParamIDs::shimmer,
+        "Shimmer",
+        range,
+        0.0f,
+        juce::String(),
+        juce::AudioProcessorParameter::genericParameter,
+        percentFormat,
+        nullptr
+    ));
+
+    layout.add(std::make_unique<juce::AudioParameterChoice>(
+        ParamIDs::quality,
+        "Quality",
+        juce::StringArray { "Eco", "Standard", "High" },
+        1
+    ));
+
+    layout.add(std::make_unique<juce::AudioParameterBool>(
+        ParamIDs::adaptiveQuality,
+        "Adaptive Quality",
+        false
+    ));
+
+    layout.add(std::make_unique<juce::AudioParameterBool>(
+        ParamIDs::bypass,
+        "Bypass",
+        false
+    ));
+
+    for (int send = 0; send < maxSendBuses; ++send)
+    {
+        layout.add(std::make_unique<juce::AudioParameterFloat>(
+            ParamIDs::sendLevel(send),
+            "Send " + juce::String(send + 1) + " Level",
+            range,
+            1.0f,
+            juce::String(),
+            juce::AudioProcessorParameter::genericParameter,
+            percentFormat,
+            nullptr
+        ));
+    }
+
     return layout;
 }
 
@@ -127,12 +290,16 @@ public:
     //==============================================================================
     void prepareToPlay (double sampleRate, int samplesPerBlock) override;
     void releaseResources() override;
+    void setNonRealtime (bool isNonRealtime) noexcept override;
 
    #ifndef JucePlugin_PreferredChannelConfigurations
     bool isBusesLayoutSupported (const BusesLayout& layouts) const override;
    #endif
 
     void processBlock (juce::AudioBuffer<float>&, juce::MidiBuffer&) override;
+    void processBlockBypassed (juce::AudioBuffer<float>&, juce::MidiBuffer&) override;
+
+    juce::AudioProcessorParameter* getBypassParameter() const override;
 
     //==============================================================================
     juce::AudioProcessorEditor* createEditor() override;
@@ -157,9 +324,33 @@ public:
     void getStateInformation (juce::MemoryBlock& destData) override;
     void setStateInformation (const void* data, int sizeInBytes) override;
 
+    //==============================================================================
+    /** What this instance holds in memory. It is measured at the end of each
+        prepareToPlay(), so it follows the sample rate, block size and budget.
+    */
+    MemoryUsage getMemoryUsage() const;
+
+    /** Caps what prepareToPlay() may allocate, in bytes, or 0 for no cap.
+        Freeverb quality tiers that don't fit are left out, and the Quality
+        setting picks from the ones that remain. Takes effect at the next
+        prepareToPlay().
+    */
+    void setMemoryBudget(size_t maxBytes) noexcept { memoryBudget = maxBytes; }
+    size_t getMemoryBudget() const noexcept { return memoryBudget; }
+
+    /** The highest Freeverb tier the memory budget left room for. */
+    ReverbQuality getMaxQuality() const noexcept { return reverb.getMaxQuality(); }
+
+    /** How much of the real-time budget processBlock is using. */
+    const DspLoadMeter& getLoadMeter() const noexcept { return loadMeter; }
+    DspLoadMeter& getLoadMeter() noexcept { return loadMeter; }
+
     juce::AudioProcessorValueTreeState apvts;
 
 private:
+   #ifndef JucePlugin_PreferredChannelConfigurations
+    static BusesProperties createBusesProperties();
+   #endif
 
     std::atomic<float>* sizeParam { nullptr };
     std::atomic<float>* dampParam { nullptr };
@@ -167,17 +358,73 @@ private:
     std::atomic<float>* mixParam   { nullptr };
     std::atomic<float>* lowShelfFreqParam {nullptr};
     std::atomic<float>* highShelfFreqParam{nullptr};
-
+    std::atomic<float>* algorithmParam { nullptr };
+    std::atomic<float>* earlyLevelParam { nullptr };
+    std::atomic<float>* earlyTapsParam { nullptr };
+    std::atomic<float>* multibandParam { nullptr };
+    std::array<std::atomic<float>*, MultibandReverb::numBands> bandDecayParams {};
+    std::atomic<float>* warmthParam { nullptr };
+    std::atomic<float>* modulationParam { nullptr };
+    std::atomic<float>* shimmerParam { nullptr };
+    std::atomic<float>* qualityParam { nullptr };
+    std::atomic<float>* adaptiveQualityParam { nullptr };
+    std::array<std::atomic<float>*, maxSendBuses> sendLevelParams {};
+    std::atomic<float>* bypassParam { nullptr };
+
+    void processInChunks(juce::AudioBuffer<float>& buffer, bool shouldBypass);
+    void process(juce::AudioBuffer<float>& buffer, bool shouldBypass);
+    void stopReverb();
     void updateReverbParams();
     void updateFilterCoefficients();
+    ReverbAlgorithm getSelectedAlgorithm() const noexcept;
+    void updateAlgorithm();
+    void updateQuality();
+    void mixSendBuses(juce::AudioBuffer<float>& buffer, juce::AudioBuffer<float>& mainBuffer);
+
+    OutputChain outputChain;
 
-    juce::dsp::IIR::Filter<float> leftLowShelfFilter;
-    juce::dsp::IIR::Filter<float> rightLowShelfFilter;
-    juce::dsp::IIR::Filter<float> leftHighShelfFilter;
-    juce::dsp::IIR::Filter<float> rightHighShelfFilter;
+    // Picked when the processor is created, rather than on the first block.
+    const DspKernels& kernels { DspKernels::get() };
 
     juce::dsp::Reverb::Parameters params;
-    juce::dsp::Reverb reverb;
+    TieredFreeverb reverb;
+    AdaptiveQuality adaptiveQuality;
+    DspLoadMeter loadMeter;
+    StageTracer tracer;
+    RenderWorker renderWorker;
+    VelvetReverb velvetReverb;
+    PlateReverb plateReverb;
+    MultibandReverb multibandReverb;
+    EarlyReflections earlyReflections;
+
+    ReverbAlgorithm algorithm { ReverbAlgorithm::freeverb };
+
+    // The block size prepareToPlay() announced, which every buffer is sized
+    // for. Some hosts send larger blocks anyway, and those are split.
+    int maxBlockSize { 0 };
+
+    // The engines run wet-only. The main input's dry signal is kept here and
+    // mixed back in by the output chain, so the sends never reach the output dry.
+    bool sendBusesActive { false };
+    juce::AudioBuffer<float> dryBuffer;
+    std::array<float, maxSendBuses> lastSendGains {};
+
+    // Bypassing fades the reverb's input out over one block and lets the tail
+    // ring out over the untouched input, which is kept in bypassDryBuffer.
+    // Once the tail has been silent for tailHoldSamples, the engines stop
+    // running altogether until the bypass is switched off again.
+    static constexpr float silentTailLevel = 1.0e-5f; // -100 dB
+    static constexpr double tailHoldSeconds = 0.25;   // longer than the early reflections and shimmer frames
+
+    bool bypassed { false };
+    bool tailRinging { false };
+    int silentTailSamples { 0 };
+    int tailHoldSamples { 0 };
+    juce::AudioBuffer<float> bypassDryBuffer;
+
+    std::atomic<size_t> memoryBudget { 0 };
+    juce::CriticalSection memoryUsageLock;
+    MemoryUsage memoryUsage;
 
     //==============================================================================
     JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR (YetiReverbAudioProcessor)
@@ -0,0 +1,90 @@
+#pragma once
+
+#include <JuceHeader.h>
+
+//==============================================================================
+/**
+    A single helper thread that lets the audio thread run a task in two halves
+    at once.
+
+    This is only meant for offline renders, where blocking the calling thread
+    for the other half is fine. The worker is woken through the thread's own
+    event and picks the task up through an atomic pointer. Nothing is
+    allocated per call. If the worker hasn't claimed the second half by the
+    time the caller has finished the first, the caller runs it as well. So a
+    busy, slow or stopped worker costs speed, but can never deadlock.
+*/
+class RenderWorker : private juce::Thread
+{
+public:
+    /** Work that can be split into two independent parts. */
+    struct Task
+    {
+        virtual ~Task() = default;
+        virtual void runPart(int part) noexcept = 0;
+    };
+
+    RenderWorker() : juce::Thread("Yeti render worker") {}
+
+    ~RenderWorker() override
+    {
+        stop();
+    }
+
+    //==============================================================================
+    void start()
+    {
+        if (! isThreadRunning())
+            startThread(juce::Thread::Priority::high);
+    }
+
+    void stop()
+    {
+        stopThread(1000);
+    }
+
+    bool isRunning() const noexcept { return isThreadRunning(); }
+
+    /** Runs part 0 of the task on the calling thread and part 1 on the worker,
+        and returns once both are done.
+    */
+    void runSplit(Task& task) noexcept
+    {
+        pending.store(&task, std::memory_order_release);
+        notify();
+
+        task.runPart(0);
+
+        if (auto* unclaimed = pending.exchange(nullptr, std::memory_order_acq_rel))
+            unclaimed->runPart(1);
+        else
+            finished.wait(-1);
+    }
+
+private:
+    //==============================================================================
+    void run() override
+    {
+        // Flush-to-zero is per thread, and the processor only sets it on the
+        // thread that calls processBlock.
+        juce::ScopedNoDenormals noDenormals;
+
+        while (! threadShouldExit())
+        {
+            wait(-1);
+
+            // A claimed task is always finished, even if we've been asked to
+            // exit, because the caller is waiting for it.
+            if (auto* task = pending.exchange(nullptr, std::memory_order_acq_rel))
+            {
+                task->runPart(1);
+                finished.signal();
+            }
+        }
+    }
+
+    std::atomic<Task*> pending { nullptr };
+    juce::WaitableEvent finished;
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR(RenderWorker)
+};
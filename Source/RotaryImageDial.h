@@ -4,35 +4,99 @@
 
 class ImageKnobLook : public LookAndFeel_V4
 {
+public:
+    static constexpr int numFrames = 91;
+
+    /** A frame scaled to the pixels the knob covers, and when it was last drawn. */
+    struct ScaledFrame
+    {
+        int index = -1;
+        Image image;
+        uint32 lastUsed = 0;
+    };
+
+    static constexpr int numScaledFrames = 12;
+
 private:
-    String imgName;
+    struct Frame
+    {
+        const char* data = nullptr;
+        int size = 0;
+    };
+
+    // The frames' PNG data, found by name once rather than on every paint.
+    std::array<Frame, numFrames> frames;
     int frameWidth = 0, frameHeight = 0;
-    Image dialImg;
+
+    // The frames drawn most recently, already scaled to the pixels the knob
+    // covers, so a knob at rest or wiggled around one value is a plain copy.
+    // Keeping all 91 would cost megabytes per knob at 2x, so the one drawn
+    // longest ago makes way for a new one. They're decoded straight from the
+    // PNG data rather than through ImageCache, which would keep all 91 at full
+    // size as well.
+    std::array<ScaledFrame, numScaledFrames> scaledFrames;
+    uint32 useCount = 0;
+    int scaledWidth = 0, scaledHeight = 0;
 
 public:
     ImageKnobLook() = default;
 
     void setImage(const String& assetName, int asset_w, int asset_h)
     {
-        imgName = assetName;
+        for (int i = 0; i < numFrames; ++i)
+        {
+            auto& frame = frames[(size_t) i];
+            frame.data = BinaryData::getNamedResource((assetName + "_" + String(i) + "_png").toRawUTF8(), frame.size);
+        }
+
         frameWidth = asset_w;
         frameHeight = asset_h;
+        scaledFrames.fill({});
     }
 
     void drawRotarySlider(Graphics& g, int x, int y, int width, int height,
-        float sliderPosProportional, float rotaryStartAngle, float rotaryEndAngle,
-        Slider& slider) override
+        float sliderPosProportional, float /*rotaryStartAngle*/, float /*rotaryEndAngle*/,
+        Slider& /*slider*/) override
     {
-        int frameIndex = static_cast<int>(sliderPosProportional * 90) % 91;
-        String assetFullName = imgName + "_" + String(frameIndex) + "_png";
-        int size = 0;
-        const char* data = BinaryData::getNamedResource(assetFullName.toUTF8(), size);
+        const int frameIndex = static_cast<int>(sliderPosProportional * 90) % numFrames;
+        const auto& frame = frames[(size_t) frameIndex];
+
+        if (frame.data == nullptr)
+            return;
+
+        const auto scale = g.getInternalContext().getPhysicalPixelScaleFactor();
+        const auto pixelWidth = jmax(1, roundToInt((float) width * scale));
+        const auto pixelHeight = jmax(1, roundToInt((float) height * scale));
 
-        if (data != nullptr) {
-            dialImg = ImageCache::getFromMemory(data, size);
-            g.drawImage(dialImg, x, y, width, height, 0, 0, frameWidth, frameHeight);
+        if (pixelWidth != scaledWidth || pixelHeight != scaledHeight)
+        {
+            scaledFrames.fill({});
+            scaledWidth = pixelWidth;
+            scaledHeight = pixelHeight;
         }
+
+        auto scaled = std::find_if(scaledFrames.begin(), scaledFrames.end(),
+                                   [frameIndex](const ScaledFrame& f) { return f.index == frameIndex; });
+
+        if (scaled == scaledFrames.end())
+        {
+            const auto source = ImageFileFormat::loadFrom(frame.data, (size_t) frame.size);
+
+            if (! source.isValid())
+                return;
+
+            scaled = std::min_element(scaledFrames.begin(), scaledFrames.end(),
+                                      [](const ScaledFrame& a, const ScaledFrame& b) { return a.lastUsed < b.lastUsed; });
+            scaled->index = frameIndex;
+            scaled->image = source.getClippedImage({ 0, 0, frameWidth, frameHeight }).rescaled(pixelWidth, pixelHeight);
+        }
+
+        scaled->lastUsed = ++useCount;
+        g.drawImage(scaled->image, Rectangle<int>(x, y, width, height).toFloat());
     }
+
+    /** The scaled frames this look holds on to; the slots not used yet have null images. */
+    const std::array<ScaledFrame, numScaledFrames>& getScaledFrames() const noexcept { return scaledFrames; }
 };
 
 
@@ -69,6 +133,8 @@ public:
         repaint();
     }
 
+    const std::array<ImageKnobLook::ScaledFrame, ImageKnobLook::numScaledFrames>& getScaledFrames() const noexcept { return lookAndFeel.getScaledFrames(); }
+
 private:
     ImageKnobLook lookAndFeel;
 
@@ -0,0 +1,278 @@
+#pragma once
+
+#include <JuceHeader.h>
+#include "MemoryUsage.h"
+
+//==============================================================================
+/**
+    An octave-up phase vocoder that runs one sample at a time, for use inside a
+    reverb's feedback loop.
+
+    Input is framed with a Hann window every hop, shifted up an octave in the
+    frequency domain and overlap-added back out. The FFT, window tables, frame
+    and spectra are all allocated in prepare(). After that no call allocates.
+    Each real frame is transformed as a half-length complex FFT, with the two
+    interleaved halves separated afterwards. That is about twice as fast as
+    juce::dsp::FFT's real-only path when no platform FFT is available.
+
+    The work for one frame is split into stages (forward FFT, phase analysis,
+    resynthesis, inverse FFT and overlap-add), and each stage runs at its own
+    fixed offset within the hop. The cost is therefore spread evenly over time
+    whatever the host's block size, and no single block has to absorb a whole
+    frame. This adds a hop of latency, which inside a reverb loop just becomes
+    part of the loop delay.
+*/
+class ShimmerStage
+{
+public:
+    ShimmerStage() = default;
+
+    //==============================================================================
+    void prepare(double sampleRate)
+    {
+        // Keep the frame around 40 ms so the pitch resolution does not depend on
+        // the sample rate.
+        const int order = sampleRate > 64000.0 ? 12 : 11;
+
+        fft = std::make_unique<juce::dsp::FFT>(order - 1);
+        frameSize = 2 * fft->getSize();
+        hopSize = frameSize / overlap;
+        stageInterval = hopSize / numStages;
+        frameMask = frameSize - 1;
+
+        window = std::make_unique<juce::dsp::WindowingFunction<float>>((size_t) frameSize, juce::dsp::WindowingFunction<float>::hann, false);
+
+        inputRing.assign((size_t) frameSize, 0.0f);
+        outputRing.assign((size_t) (2 * frameSize), 0.0f);
+        frame.assign((size_t) frameSize, 0.0f);
+
+        const auto numBins = (size_t) (frameSize / 2 + 1);
+        packed.assign(numBins, {});
+        transformed.assign(numBins, {});
+        spectrum.assign(numBins, {});
+        twiddles.resize(numBins);
+
+        for (size_t k = 0; k < numBins; ++k)
+            twiddles[k] = std::polar(1.0f, -juce::MathConstants<float>::twoPi * (float) k / (float) frameSize);
+
+        magnitudes.assign(numBins, 0.0f);
+        frequencies.assign(numBins, 0.0f);
+        analysisPhases.assign(numBins, 0.0f);
+        synthesisPhases.assign(numBins, 0.0f);
+
+        // Hann analysis and synthesis windows overlap-add to a constant; this is
+        // its reciprocal. (JUCE's inverse FFT already divides by the frame size.)
+        std::vector<float> squaredWindow((size_t) frameSize, 1.0f);
+        window->multiplyWithWindowingTable(squaredWindow.data(), (size_t) frameSize);
+        window->multiplyWithWindowingTable(squaredWindow.data(), (size_t) frameSize);
+
+        const auto windowPower = std::accumulate(squaredWindow.begin(), squaredWindow.end(), 0.0f);
+        outputScale = (float) hopSize / windowPower;
+
+        reset();
+    }
+
+    void reset() noexcept
+    {
+        std::fill(inputRing.begin(), inputRing.end(), 0.0f);
+        std::fill(outputRing.begin(), outputRing.end(), 0.0f);
+        std::fill(analysisPhases.begin(), analysisPhases.end(), 0.0f);
+        std::fill(synthesisPhases.begin(), synthesisPhases.end(), 0.0f);
+
+        inputIndex = 0;
+        outputIndex = 0;
+        hopPosition = 0;
+    }
+
+    bool isPrepared() const noexcept { return fft != nullptr; }
+
+    /** Frees everything prepare() allocated. Call prepare() again before use. */
+    void release() noexcept
+    {
+        fft.reset();
+        window.reset();
+        frameSize = 0;
+
+        for (auto* buffer : { &inputRing, &outputRing, &frame, &magnitudes, &frequencies, &analysisPhases, &synthesisPhases })
+            MemoryUsage::release(*buffer);
+
+        for (auto* bins : { &packed, &transformed, &spectrum, &twiddles })
+            MemoryUsage::release(*bins);
+    }
+
+    void addMemoryUsage(MemoryUsage& usage) const noexcept
+    {
+        usage.spectral += (size_t) frameSize * sizeof(float); // the window table
+
+        for (const auto* buffer : { &inputRing, &outputRing, &frame, &magnitudes, &frequencies, &analysisPhases, &synthesisPhases })
+            usage.spectral += MemoryUsage::bytesOf(*buffer);
+
+        for (const auto* bins : { &packed, &transformed, &spectrum, &twiddles })
+            usage.spectral += MemoryUsage::bytesOf(*bins);
+    }
+
+    /** Pushes one input sample and returns the next pitch-shifted output sample. */
+    float processSample(float input) noexcept
+    {
+        inputRing[(size_t) inputIndex] = input;
+        inputIndex = (inputIndex + 1) & frameMask;
+
+        auto& slot = outputRing[(size_t) outputIndex];
+        const auto output = slot;
+        slot = 0.0f;
+        outputIndex = (outputIndex + 1) % (int) outputRing.size();
+
+        if (hopPosition % stageInterval == 0)
+            runStage(hopPosition / stageInterval);
+
+        if (++hopPosition == hopSize)
+            hopPosition = 0;
+
+        return output;
+    }
+
+private:
+    //==============================================================================
+    static constexpr int overlap = 4;
+    static constexpr int numStages = 4;
+
+    void runStage(int stage) noexcept
+    {
+        switch (stage)
+        {
+            case 0:  analyseFrame();     break;
+            case 1:  shiftPhases();      break;
+            case 2:  resynthesise();     break;
+            case 3:  overlapAddFrame();  break;
+            default: jassertfalse;       break;
+        }
+    }
+
+    /** Unrolls the last frameSize inputs into the frame and transforms them. */
+    void analyseFrame() noexcept
+    {
+        const auto firstRun = frameSize - inputIndex;
+
+        std::copy(inputRing.begin() + inputIndex, inputRing.end(), frame.begin());
+        std::copy(inputRing.begin(), inputRing.begin() + inputIndex, frame.begin() + firstRun);
+
+        window->multiplyWithWindowingTable(frame.data(), (size_t) frameSize);
+
+        // Even samples go in the real part and odd samples in the imaginary part.
+        // Each bin of the full spectrum is then rebuilt from a pair of bins.
+        const auto half = frameSize / 2;
+        for (int n = 0; n < half; ++n)
+            packed[(size_t) n] = { frame[(size_t) (2 * n)], frame[(size_t) (2 * n + 1)] };
+
+        fft->perform(packed.data(), transformed.data(), false);
+        transformed[(size_t) half] = transformed[0];
+
+        for (int k = 0; k <= half; ++k)
+        {
+            const auto a = transformed[(size_t) k];
+            const auto b = std::conj(transformed[(size_t) (half - k)]);
+            const auto even = (a + b) * 0.5f;
+            const auto odd = (a - b) * std::complex<float>(0.0f, -0.5f);
+
+            spectrum[(size_t) k] = even + twiddles[(size_t) k] * odd;
+        }
+    }
+
+    /** Measures each bin's true frequency, then moves it to the bin an octave up. */
+    void shiftPhases() noexcept
+    {
+        const auto numBins = (int) magnitudes.size();
+        const auto binAdvance = juce::MathConstants<float>::twoPi * (float) hopSize / (float) frameSize;
+
+        std::fill(magnitudes.begin(), magnitudes.end(), 0.0f);
+
+        for (int bin = 0; bin < numBins; ++bin)
+        {
+            const auto re = spectrum[(size_t) bin].real();
+            const auto im = spectrum[(size_t) bin].imag();
+            const auto phase = std::atan2(im, re);
+
+            auto deviation = phase - analysisPhases[(size_t) bin] - binAdvance * (float) bin;
+            deviation -= juce::MathConstants<float>::twoPi * std::round(deviation / juce::MathConstants<float>::twoPi);
+            analysisPhases[(size_t) bin] = phase;
+
+            // DC would map onto itself and just recirculate unshifted, so it is dropped.
+            const auto target = 2 * bin;
+
+            if (bin > 0 && target < numBins)
+            {
+                magnitudes[(size_t) target] += std::sqrt(re * re + im * im);
+                frequencies[(size_t) target] = 2.0f * (binAdvance * (float) bin + deviation);
+            }
+        }
+    }
+
+    /** Advances the synthesis phases and rebuilds the shifted spectrum. */
+    void resynthesise() noexcept
+    {
+        const auto numBins = (int) magnitudes.size();
+
+        for (int bin = 0; bin < numBins; ++bin)
+        {
+            const auto magnitude = magnitudes[(size_t) bin];
+            auto& phase = synthesisPhases[(size_t) bin];
+
+            if (magnitude > 0.0f)
+                phase = std::remainder(phase + frequencies[(size_t) bin], juce::MathConstants<float>::twoPi);
+
+            spectrum[(size_t) bin] = { magnitude * std::cos(phase), magnitude * std::sin(phase) };
+        }
+    }
+
+    /** Inverse-transforms the frame and adds it in, starting one hop ahead of the
+        read position so it is complete before the first of it is read.
+    */
+    void overlapAddFrame() noexcept
+    {
+        // The reverse of the split in analyseFrame(): fold the spectrum back
+        // into a half-length one whose inverse has the even and odd samples
+        // interleaved in its real and imaginary parts.
+        const auto half = frameSize / 2;
+
+        for (int k = 0; k < half; ++k)
+        {
+            const auto a = spectrum[(size_t) k];
+            const auto b = std::conj(spectrum[(size_t) (half - k)]);
+            const auto even = (a + b) * 0.5f;
+            const auto odd = (a - b) * 0.5f * std::conj(twiddles[(size_t) k]);
+
+            transformed[(size_t) k] = even + std::complex<float>(0.0f, 1.0f) * odd;
+        }
+
+        fft->perform(transformed.data(), packed.data(), true);
+
+        for (int n = 0; n < half; ++n)
+        {
+            frame[(size_t) (2 * n)] = packed[(size_t) n].real();
+            frame[(size_t) (2 * n + 1)] = packed[(size_t) n].imag();
+        }
+
+        window->multiplyWithWindowingTable(frame.data(), (size_t) frameSize);
+
+        const auto ringSize = (int) outputRing.size();
+        const auto start = (outputIndex + hopSize - hopPosition) % ringSize;
+        const auto firstRun = juce::jmin(frameSize, ringSize - start);
+
+        juce::FloatVectorOperations::addWithMultiply(outputRing.data() + start, frame.data(), outputScale, firstRun);
+        juce::FloatVectorOperations::addWithMultiply(outputRing.data(), frame.data() + firstRun, outputScale, frameSize - firstRun);
+    }
+
+    //==============================================================================
+    std::unique_ptr<juce::dsp::FFT> fft;
+    std::unique_ptr<juce::dsp::WindowingFunction<float>> window;
+
+    int frameSize = 0, hopSize = 0, stageInterval = 0, frameMask = 0;
+    int inputIndex = 0, outputIndex = 0, hopPosition = 0;
+    float outputScale = 1.0f;
+
+    std::vector<float> inputRing, outputRing, frame;
+    std::vector<std::complex<float>> packed, transformed, spectrum, twiddles;
+    std::vector<float> magnitudes, frequencies, analysisPhases, synthesisPhases;
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR(ShimmerStage)
+};
@@ -0,0 +1,322 @@
+#pragma once
+
+#include <JuceHeader.h>
+
+#if JUCE_INTEL
+ #if JUCE_MSVC
+  #include <intrin.h>
+ #else
+  #include <x86intrin.h>
+ #endif
+#endif
+
+// Set by the YETI_ENABLE_TRACING CMake option. Without it, YETI_TRACE_SCOPE
+// compiles to nothing.
+#ifndef YETI_TRACING
+ #define YETI_TRACING 0
+#endif
+
+/** The parts of processBlock that are traced. */
+enum class TraceStage : juce::uint8
+{
+    processBlock,
+    parameters,         // reading the parameters and pushing them to the engines
+    coefficients,       // the shelf coefficients
+    input,              // copying the dry signal and mixing in the sends
+    reverb,
+    earlyReflections,
+    outputChain,        // the dry mix and both shelves, which run as one pass
+    numStages
+};
+
+class TraceWriter;
+
+//==============================================================================
+/**
+    Records how long each stage of processBlock takes, for viewing alongside a
+    host's timeline in chrome://tracing or Perfetto.
+
+    Each processor owns one. A stage is timed by a YETI_TRACE_SCOPE, which
+    reads the CPU's timestamp counter at either end and pushes the pair into
+    this instance's ring buffer. The ring has one writer, the audio thread,
+    and one reader, the TraceWriter thread, which drains every instance into
+    the file named by the YETI_TRACE_FILE environment variable. If that isn't
+    set, nothing is allocated and each scope costs one branch.
+
+    When the ring is full because the writer has fallen behind, events are
+    dropped rather than blocking the audio thread, and the trace records how
+    many were lost.
+*/
+class StageTracer
+{
+public:
+    StageTracer();
+    ~StageTracer();
+
+    bool isEnabled() const noexcept { return ! events.empty(); }
+
+    /** A timestamp in CPU cycles, or in high-resolution ticks where there is
+        no cycle counter.
+    */
+    static juce::uint64 now() noexcept
+    {
+       #if JUCE_INTEL
+        return __rdtsc();
+       #else
+        return (juce::uint64) juce::Time::getHighResolutionTicks();
+       #endif
+    }
+
+    /** Audio thread: adds a finished stage to the ring, or drops it if the
+        ring is full.
+    */
+    void record(TraceStage stage, juce::uint64 start, juce::uint64 end) noexcept
+    {
+        const auto write = writeIndex.load(std::memory_order_relaxed);
+
+        if (write - readIndex.load(std::memory_order_acquire) >= (juce::uint32) events.size())
+        {
+            dropped.fetch_add(1, std::memory_order_relaxed);
+            return;
+        }
+
+        events[write & mask] = { start, end, stage };
+        writeIndex.store(write + 1, std::memory_order_release);
+    }
+
+    /** Times the stage from construction to destruction. */
+    class Scope
+    {
+    public:
+        Scope(StageTracer& tracerToUse, TraceStage stageToTime) noexcept
+            : tracer(tracerToUse), stage(stageToTime), start(tracer.isEnabled() ? now() : 0)
+        {
+        }
+
+        ~Scope()
+        {
+            if (tracer.isEnabled())
+                tracer.record(stage, start, now());
+        }
+
+    private:
+        StageTracer& tracer;
+        TraceStage stage;
+        juce::uint64 start;
+
+        JUCE_DECLARE_NON_COPYABLE(Scope)
+    };
+
+private:
+    friend class TraceWriter;
+
+    struct Event
+    {
+        juce::uint64 start, end;
+        TraceStage stage;
+    };
+
+    /** Writer thread: passes every waiting event to the callback, oldest first. */
+    template <typename Callback>
+    void drain(Callback&& callback)
+    {
+        const auto write = writeIndex.load(std::memory_order_acquire);
+        auto read = readIndex.load(std::memory_order_relaxed);
+
+        for (; read != write; ++read)
+            callback(events[read & mask]);
+
+        readIndex.store(read, std::memory_order_release);
+    }
+
+    // Up to seven events a block, so about 1.5 s of 64-sample blocks at 48 kHz.
+    // A busy machine can delay the writer by many polls before anything is lost.
+    static constexpr juce::uint32 capacity = 1 << 13;
+    static constexpr juce::uint32 mask = capacity - 1;
+
+    std::vector<Event> events;
+    std::atomic<juce::uint32> writeIndex { 0 }, readIndex { 0 }, dropped { 0 };
+    int id = 0;     // the trace's thread id, so each instance gets its own track
+
+   #if YETI_TRACING
+    juce::SharedResourcePointer<TraceWriter> writer;
+   #endif
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR(StageTracer)
+};
+
+#if YETI_TRACING
+ #define YETI_TRACE_SCOPE(tracer, stage) const StageTracer::Scope JUCE_JOIN_MACRO(traceScope, __LINE__)(tracer, stage)
+#else
+ #define YETI_TRACE_SCOPE(tracer, stage)
+#endif
+
+//==============================================================================
+/**
+    The background thread shared by every StageTracer in the process. It polls
+    its clients' rings and appends what it finds to the trace file in the
+    Chrome trace event format, so the audio thread never has to signal it.
+
+    The file is a JSON array of complete ("X") events with timestamps in
+    microseconds. If the process dies before the closing bracket is written,
+    the trace viewers still accept it. The writer lives as long as any
+    instance does, so a host that deletes every instance and then makes a
+    new one starts the file over.
+*/
+class TraceWriter : private juce::Thread
+{
+public:
+    TraceWriter() : juce::Thread("Yeti trace writer")
+    {
+        const auto path = juce::SystemStats::getEnvironmentVariable("YETI_TRACE_FILE", {});
+
+        if (path.isEmpty())
+            return;
+
+        const juce::File file(juce::File::getCurrentWorkingDirectory().getChildFile(path));
+        file.deleteFile();
+        stream = std::make_unique<juce::FileOutputStream>(file);
+
+        if (! stream->openedOk())
+        {
+            stream.reset();
+            return;
+        }
+
+        *stream << "[";
+        calibrate();
+        startThread(juce::Thread::Priority::low);
+    }
+
+    ~TraceWriter() override
+    {
+        stopThread(1000);
+
+        if (stream != nullptr)
+        {
+            *stream << "\n]\n";
+            stream->flush();
+        }
+    }
+
+    bool isWriting() const noexcept { return stream != nullptr; }
+
+    void addClient(StageTracer* client)
+    {
+        const juce::ScopedLock sl(clientLock);
+        clients.addIfNotAlreadyThere(client);
+
+        writeEvent("{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":" + juce::String(client->id)
+                   + ",\"args\":{\"name\":\"Yeti Reverb #" + juce::String(client->id) + "\"}}");
+    }
+
+    void removeClient(StageTracer* client)
+    {
+        const juce::ScopedLock sl(clientLock);
+        drain(*client);
+        clients.removeFirstMatchingValue(client);
+    }
+
+private:
+    void run() override
+    {
+        while (! threadShouldExit())
+        {
+            {
+                const juce::ScopedLock sl(clientLock);
+
+                for (auto* client : clients)
+                    drain(*client);
+
+                stream->flush();
+            }
+
+            wait(pollIntervalMs);
+        }
+    }
+
+    /** Measures the timestamp counter against the system's high-resolution
+        clock, and notes where both were at the same moment, so events can be
+        placed on the same timeline as a host's trace.
+    */
+    void calibrate()
+    {
+        const auto startTime = juce::Time::getMillisecondCounterHiRes();
+        const auto startCount = StageTracer::now();
+        juce::Thread::sleep(calibrationMs);
+        const auto endTime = juce::Time::getMillisecondCounterHiRes();
+        const auto endCount = StageTracer::now();
+
+        baseCount = startCount;
+        baseMicroseconds = startTime * 1000.0;
+        microsecondsPerCount = (endTime - startTime) * 1000.0 / (double) std::max<juce::uint64>(1, endCount - startCount);
+    }
+
+    void drain(StageTracer& client)
+    {
+        client.drain([this, &client](const StageTracer::Event& event)
+        {
+            const auto start = baseMicroseconds + (double) (juce::int64) (event.start - baseCount) * microsecondsPerCount;
+            const auto duration = (double) (event.end - event.start) * microsecondsPerCount;
+
+            writeEvent("{\"name\":\"" + juce::String(stageNames[(size_t) event.stage]) + "\",\"cat\":\"yeti\",\"ph\":\"X\""
+                       + ",\"ts\":" + juce::String(start, 3) + ",\"dur\":" + juce::String(duration, 3)
+                       + ",\"pid\":1,\"tid\":" + juce::String(client.id) + "}");
+        });
+
+        if (const auto dropped = client.dropped.exchange(0, std::memory_order_relaxed))
+            writeEvent("{\"name\":\"dropped events\",\"ph\":\"i\",\"s\":\"t\",\"ts\":"
+                       + juce::String(juce::Time::getMillisecondCounterHiRes() * 1000.0, 3)
+                       + ",\"pid\":1,\"tid\":" + juce::String(client.id)
+                       + ",\"args\":{\"count\":" + juce::String(dropped) + "}}");
+    }
+
+    void writeEvent(const juce::String& json)
+    {
+        if (stream == nullptr)
+            return;
+
+        *stream << (firstEvent ? "\n" : ",\n") << json;
+        firstEvent = false;
+    }
+
+    static constexpr int pollIntervalMs = 20;
+    static constexpr int calibrationMs = 50;
+
+    static constexpr std::array<const char*, (size_t) TraceStage::numStages> stageNames {
+        "processBlock", "parameters", "coefficients", "input", "reverb", "earlyReflections", "outputChain"
+    };
+
+    juce::CriticalSection clientLock;
+    juce::Array<StageTracer*> clients;
+
+    std::unique_ptr<juce::FileOutputStream> stream;
+    bool firstEvent = true;
+
+    juce::uint64 baseCount = 0;
+    double baseMicroseconds = 0.0, microsecondsPerCount = 0.0;
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR(TraceWriter)
+};
+
+inline StageTracer::StageTracer()
+{
+   #if YETI_TRACING
+    static std::atomic<int> instances { 0 };
+    id = ++instances;
+
+    if (writer->isWriting())
+    {
+        events.resize(capacity);
+        writer->addClient(this);
+    }
+   #endif
+}
+
+inline StageTracer::~StageTracer()
+{
+   #if YETI_TRACING
+    if (isEnabled())
+        writer->removeClient(this);
+   #endif
+}
@@ -0,0 +1,452 @@
+#pragma once
+
+#include <JuceHeader.h>
+#include "FreeverbNetwork.h"
+
+enum class ReverbQuality
+{
+    eco,        // half the combs at half the sample rate, no modulation
+    standard,   // the full network at the host rate
+    high        // the full network, 2x oversampled
+};
+
+//==============================================================================
+/**
+    The Freeverb network at three CPU costs, switchable while playing.
+
+    Each tier is a separate network, and all three are allocated in prepare(),
+    so switching never allocates. Under a memory budget, prepare() only
+    allocates the tiers that fit, cheapest first, and requests for a higher
+    tier get the best one available. The Eco and High networks run at their own
+    internal rate. Like the networks, every tier outputs the wet signal only;
+    the processor mixes the dry signal in at the host rate, so it is never
+    filtered or delayed by the rate conversion.
+
+    Changing tier resets the incoming network and crossfades to it over
+    crossfadeSeconds. Both tiers run for the length of the fade.
+*/
+class TieredFreeverb
+{
+public:
+    using Parameters = juce::Reverb::Parameters;
+
+    static constexpr double crossfadeSeconds = 0.1;
+
+    TieredFreeverb() = default;
+
+    //==============================================================================
+    const Parameters& getParameters() const noexcept { return standard.getParameters(); }
+
+    /** The decay time of the full network, which Eco's shorter combs stay within. */
+    static double getDecaySeconds(const Parameters& params) noexcept
+    {
+        return FreeverbNetwork<>::getDecaySeconds(params);
+    }
+
+    void setParameters(const Parameters& newParams)
+    {
+        eco.setParameters(newParams);
+        standard.setParameters(newParams);
+        high.setParameters(newParams);
+    }
+
+    void setWarmth(float amount) noexcept
+    {
+        eco.setWarmth(amount);
+        standard.setWarmth(amount);
+        high.setWarmth(amount);
+    }
+
+    /** Eco ignores this and always runs with static delays. */
+    void setModulation(float depth) noexcept
+    {
+        standard.setModulation(depth);
+        high.setModulation(depth);
+    }
+
+    void setShimmer(float amount) noexcept
+    {
+        eco.setShimmer(amount);
+        standard.setShimmer(amount);
+        high.setShimmer(amount);
+    }
+
+    /** Passed on to every tier's network; see FreeverbNetwork::setRenderWorker(). */
+    void setRenderWorker(RenderWorker* worker) noexcept
+    {
+        eco.setRenderWorker(worker);
+        standard.setRenderWorker(worker);
+        high.setRenderWorker(worker);
+    }
+
+    /** Requests a tier. The switch starts with the next block, or when the
+        current crossfade finishes.
+    */
+    void setQuality(ReverbQuality newQuality) noexcept { requested = newQuality; }
+
+    ReverbQuality getQuality() const noexcept { return current; }
+
+    /** The highest tier the last prepare() had room for. */
+    ReverbQuality getMaxQuality() const noexcept { return maxQuality; }
+
+    /** True while a tier change is being crossfaded, i.e. both tiers are running. */
+    bool isCrossfading() const noexcept { return fadeRemaining > 0 || getAvailable(requested) != current; }
+
+    //==============================================================================
+    /** Allocates Eco, then Standard and High for as long as the total stays
+        within maxBytes. Eco is always allocated, even if it doesn't fit.
+    */
+    void prepare(const juce::dsp::ProcessSpec& spec, size_t maxBytes = std::numeric_limits<size_t>::max())
+    {
+        jassert(spec.sampleRate > 0);
+
+        const auto maxBlockSize = (int) spec.maximumBlockSize;
+        const auto maxHalfBlockSize = maxBlockSize / 2 + 1;
+
+        eco.setInternalRateRatio(0.5);
+        high.setInternalRateRatio(2.0);
+
+        fadeBuffer.setSize(numChannels, maxBlockSize);
+        halfRateBuffer.setSize(numChannels, maxHalfBlockSize);
+
+        // Each tier is freed first, so the total never goes over by more than
+        // the tier being tried.
+        standard.release();
+        high.release();
+        oversampling.reset();
+
+        eco.prepare({ spec.sampleRate * 0.5, (juce::uint32) maxHalfBlockSize, spec.numChannels });
+        maxQuality = ReverbQuality::eco;
+
+        standard.prepare(spec);
+
+        if (getMemoryUsage().getTotal() > maxBytes)
+        {
+            standard.release();
+        }
+        else
+        {
+            maxQuality = ReverbQuality::standard;
+
+            oversampling = std::make_unique<juce::dsp::Oversampling<float>>((size_t) numChannels, 1,
+                                                                           juce::dsp::Oversampling<float>::filterHalfBandPolyphaseIIR);
+            oversampling->initProcessing(spec.maximumBlockSize);
+            high.prepare({ spec.sampleRate * 2.0, spec.maximumBlockSize * 2, spec.numChannels });
+            oversampledBlockSize = spec.maximumBlockSize * 2;
+
+            if (getMemoryUsage().getTotal() > maxBytes)
+            {
+                high.release();
+                oversampling.reset();
+            }
+            else
+            {
+                maxQuality = ReverbQuality::high;
+            }
+        }
+
+        fadeLength = juce::jmax(1, juce::roundToInt(crossfadeSeconds * spec.sampleRate));
+
+        // Nothing is playing yet, so reset() starts the requested tier straight away.
+        reset();
+    }
+
+    /** Clears every tier. There is nothing left to fade from, so a tier
+        requested since the last block takes over straight away.
+    */
+    void reset() noexcept
+    {
+        for (auto tier : { ReverbQuality::eco, ReverbQuality::standard, ReverbQuality::high })
+            resetTier(tier);
+
+        current = previous = getAvailable(requested);
+        fadeRemaining = 0;
+    }
+
+    /** What the allocated tiers and their buffers hold. */
+    MemoryUsage getMemoryUsage() const noexcept
+    {
+        MemoryUsage usage;
+
+        for (const auto* network : { &standard, &high })
+            network->addMemoryUsage(usage);
+
+        eco.addMemoryUsage(usage);
+
+        for (const auto* buffer : { &fadeBuffer, &halfRateBuffer })
+            usage.blockBuffers += MemoryUsage::bytesOf(*buffer);
+
+        // The oversampler's one buffer holds the 2x signal for every channel.
+        if (oversampling != nullptr)
+            usage.blockBuffers += (size_t) numChannels * oversampledBlockSize * sizeof(float);
+
+        return usage;
+    }
+
+    //==============================================================================
+    template <typename ProcessContext>
+    void process(const ProcessContext& context) noexcept
+    {
+        const auto& inputBlock = context.getInputBlock();
+        auto& outputBlock = context.getOutputBlock();
+
+        jassert(inputBlock.getNumSamples() == outputBlock.getNumSamples());
+        outputBlock.copyFrom(inputBlock);
+
+        if (context.isBypassed)
+            return;
+
+        if (fadeRemaining == 0 && getAvailable(requested) != current)
+        {
+            previous = current;
+            current = getAvailable(requested);
+            fadeRemaining = fadeLength;
+            resetTier(current);
+        }
+
+        if (fadeRemaining == 0)
+        {
+            processTier(current, outputBlock);
+            return;
+        }
+
+        auto fadeBlock = juce::dsp::AudioBlock<float>(fadeBuffer)
+                             .getSubsetChannelBlock(0, outputBlock.getNumChannels())
+                             .getSubBlock(0, outputBlock.getNumSamples());
+        fadeBlock.copyFrom(outputBlock);
+
+        processTier(previous, fadeBlock);
+        processTier(current, outputBlock);
+        crossfade(fadeBlock, outputBlock);
+    }
+
+private:
+    //==============================================================================
+    static constexpr int numChannels = 2;
+
+    //==============================================================================
+    /** A two-path polyphase allpass half-band filter, flat to 0.22 fs and about
+        70 dB down from 0.3 fs. Both paths run at the low rate, so each sample
+        of the low-rate side costs four first-order allpasses.
+
+        One instance either decimates (pushSample) or interpolates (pullSample),
+        keeping its own even/odd phase so blocks of any length can be split.
+    */
+    class HalfBandFilter
+    {
+    public:
+        void reset() noexcept
+        {
+            for (auto& path : state)
+                for (auto& section : path)
+                    section = {};
+
+            held = 0.0f;
+            odd = false;
+        }
+
+        /** Takes one high-rate sample. Every other call returns true with the
+            next low-rate sample in output.
+        */
+        bool pushSample(float input, float& output) noexcept
+        {
+            if (odd)
+            {
+                held = runPath(1, input);
+                odd = false;
+                return false;
+            }
+
+            output = 0.5f * (runPath(0, input) + held);
+            odd = true;
+            return true;
+        }
+
+        /** Returns the next high-rate sample, taking a new low-rate one from
+            input (and advancing it) on every other call.
+        */
+        float pullSample(const float*& input) noexcept
+        {
+            if (odd)
+            {
+                odd = false;
+                return held;
+            }
+
+            const auto sample = *input++;
+            held = runPath(1, sample);
+            odd = true;
+            return runPath(0, sample);
+        }
+
+    private:
+        struct Section { float x1 = 0.0f, y1 = 0.0f; };
+
+        static constexpr int sectionsPerPath = 2;
+        static constexpr float coefficients[2][sectionsPerPath] = { { 0.07986642623635751f, 0.5453536510711322f },
+                                                                    { 0.28382934487410993f, 0.8344118914807379f } };
+
+        float runPath(int path, float sample) noexcept
+        {
+            for (int i = 0; i < sectionsPerPath; ++i)
+            {
+                auto& section = state[path][i];
+                const auto output = coefficients[path][i] * (sample - section.y1) + section.x1;
+                section.x1 = sample;
+                section.y1 = output;
+                sample = output;
+            }
+
+            return sample;
+        }
+
+        Section state[2][sectionsPerPath];
+        float held = 0.0f;
+        bool odd = false;
+    };
+
+    /** The tier to run when asked for this one. */
+    ReverbQuality getAvailable(ReverbQuality tier) const noexcept
+    {
+        return tier > maxQuality ? maxQuality : tier;
+    }
+
+    void resetTier(ReverbQuality tier) noexcept
+    {
+        switch (tier)
+        {
+            case ReverbQuality::eco:
+                eco.reset();
+                decimator.reset();
+
+                for (auto& filter : interpolator)
+                    filter.reset();
+
+                break;
+
+            case ReverbQuality::high:
+                high.reset();
+
+                if (oversampling != nullptr)
+                    oversampling->reset();
+
+                break;
+
+            case ReverbQuality::standard:
+            default:
+                standard.reset();
+                break;
+        }
+    }
+
+    /** Replaces the input in block with one tier's wet output. */
+    void processTier(ReverbQuality tier, juce::dsp::AudioBlock<float>& block) noexcept
+    {
+        switch (tier)
+        {
+            case ReverbQuality::eco:  processEco(block);  break;
+            case ReverbQuality::high: processHigh(block); break;
+            case ReverbQuality::standard:
+            default:
+                standard.process(juce::dsp::ProcessContextReplacing<float>(block));
+                break;
+        }
+    }
+
+    /** Decimates the mono sum of the input, runs the small network at half the
+        rate and interpolates its output back up.
+    */
+    void processEco(juce::dsp::AudioBlock<float>& block) noexcept
+    {
+        const auto numBlockChannels = block.getNumChannels();
+        const auto numSamples = (int) block.getNumSamples();
+
+        const auto* left = block.getChannelPointer(0);
+        const auto* right = numBlockChannels > 1 ? block.getChannelPointer(1) : nullptr;
+        auto* halfLeft = halfRateBuffer.getWritePointer(0);
+        int numHalfSamples = 0;
+
+        for (int i = 0; i < numSamples; ++i)
+        {
+            const auto input = right != nullptr ? left[i] + right[i] : left[i];
+
+            if (decimator.pushSample(input, halfLeft[numHalfSamples]))
+                ++numHalfSamples;
+        }
+
+        // The network takes the sum of its inputs anyway, so the right channel
+        // is left silent.
+        auto halfBlock = juce::dsp::AudioBlock<float>(halfRateBuffer)
+                             .getSubsetChannelBlock(0, numBlockChannels)
+                             .getSubBlock(0, (size_t) numHalfSamples);
+
+        if (numBlockChannels > 1)
+            halfBlock.getSingleChannelBlock(1).clear();
+
+        eco.process(juce::dsp::ProcessContextReplacing<float>(halfBlock));
+
+        // The input has all been decimated by now, so the output can go
+        // straight into the block.
+        for (size_t channel = 0; channel < numBlockChannels; ++channel)
+        {
+            const auto* wet = halfBlock.getChannelPointer(channel);
+            auto* output = block.getChannelPointer(channel);
+            auto& filter = interpolator[channel];
+
+            for (int i = 0; i < numSamples; ++i)
+                output[i] = filter.pullSample(wet);
+
+            jassert(wet == halfBlock.getChannelPointer(channel) + numHalfSamples);
+        }
+    }
+
+    void processHigh(juce::dsp::AudioBlock<float>& block) noexcept
+    {
+        auto oversampled = oversampling->processSamplesUp(block)
+                               .getSubsetChannelBlock(0, block.getNumChannels());
+        high.process(juce::dsp::ProcessContextReplacing<float>(oversampled));
+        oversampling->processSamplesDown(block);
+    }
+
+    /** Fades from the outgoing tier's output to the incoming tier's, in place. */
+    void crossfade(const juce::dsp::AudioBlock<float>& outgoing, juce::dsp::AudioBlock<float>& incoming) noexcept
+    {
+        const auto numSamples = (int) incoming.getNumSamples();
+        const auto step = 1.0f / (float) fadeLength;
+
+        for (size_t channel = 0; channel < incoming.getNumChannels(); ++channel)
+        {
+            const auto* from = outgoing.getChannelPointer(channel);
+            auto* to = incoming.getChannelPointer(channel);
+            auto remaining = fadeRemaining;
+
+            for (int i = 0; i < numSamples; ++i)
+            {
+                const auto gain = remaining > 0 ? (float) remaining-- * step : 0.0f;
+                to[i] += (from[i] - to[i]) * gain;
+            }
+        }
+
+        fadeRemaining = juce::jmax(0, fadeRemaining - numSamples);
+    }
+
+    //==============================================================================
+    FreeverbNetwork<4> eco;
+    FreeverbNetwork<> standard, high;
+
+    // Only allocated along with the High tier.
+    std::unique_ptr<juce::dsp::Oversampling<float>> oversampling;
+    size_t oversampledBlockSize = 0;
+
+    HalfBandFilter decimator, interpolator[numChannels];
+
+    juce::AudioBuffer<float> fadeBuffer, halfRateBuffer;
+
+    ReverbQuality maxQuality = ReverbQuality::high;
+    ReverbQuality requested = ReverbQuality::standard;
+    ReverbQuality current = ReverbQuality::standard;
+    ReverbQuality previous = ReverbQuality::standard;
+    int fadeLength = 1, fadeRemaining = 0;
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR(TieredFreeverb)
+};
@@ -0,0 +1,391 @@
+#pragma once
+
+#include <JuceHeader.h>
+#include "MemoryUsage.h"
+
+//==============================================================================
+/**
+    An ultra-low-CPU late reverb built from velvet noise.
+
+    Each channel feeds its input through a short allpass diffuser into a single damped
+    recirculating delay. The tail is read out of that delay through a sparse set of
+    velvet-noise taps (one pulse of random sign per grid interval), so every output
+    sample costs a handful of additions rather than a bank of comb filters.
+
+    Pulse positions and signs are generated in prepare() and never touched on the
+    audio thread. Because the loop is far longer than a processing chunk, each chunk is
+    written before any tap reads it, and every tap becomes one contiguous vector add.
+
+    The parameters are shared with juce::dsp::Reverb so this engine can sit behind the
+    same size/damp/width/mix controls. Only the wet signal comes out; dryLevel is unused.
+*/
+class VelvetReverb
+{
+public:
+    using Parameters = juce::Reverb::Parameters;
+
+    VelvetReverb() = default;
+
+    //==============================================================================
+    const Parameters& getParameters() const noexcept { return parameters; }
+
+    /** The RT60 with these parameters, or infinity when frozen. The loop is
+        scaled to decay like Freeverb's average comb.
+    */
+    static double getDecaySeconds(const Parameters& params) noexcept
+    {
+        if (params.freezeMode >= 0.5f)
+            return std::numeric_limits<double>::infinity();
+
+        return referenceCombSeconds * -3.0 / std::log10((double) (params.roomSize * 0.28f + 0.7f));
+    }
+
+    void setParameters(const Parameters& newParams)
+    {
+        const float wetScaleFactor = 3.0f;
+        const float wet = newParams.wetLevel * wetScaleFactor;
+
+        wetGain1.setTargetValue(0.5f * wet * (1.0f + newParams.width));
+        wetGain2.setTargetValue(0.5f * wet * (1.0f - newParams.width));
+
+        parameters = newParams;
+        updateDecay();
+    }
+
+    //==============================================================================
+    void prepare(const juce::dsp::ProcessSpec& spec)
+    {
+        jassert(spec.sampleRate > 0);
+
+        for (int i = 0; i < numChannels; ++i)
+        {
+            juce::Random random(pulseSeed + i);
+            channels[i].prepare(spec.sampleRate, i * stereoSpread, random);
+        }
+
+        const double smoothTime = 0.01;
+        damping.reset(spec.sampleRate, smoothTime);
+        feedback.reset(spec.sampleRate, smoothTime);
+        wetGain1.reset(spec.sampleRate, smoothTime);
+        wetGain2.reset(spec.sampleRate, smoothTime);
+
+        updateDecay();
+    }
+
+    void reset() noexcept
+    {
+        for (auto& channel : channels)
+            channel.clear();
+    }
+
+    void addMemoryUsage(MemoryUsage& usage) const noexcept
+    {
+        for (const auto& channel : channels)
+            channel.addMemoryUsage(usage);
+    }
+
+    //==============================================================================
+    template <typename ProcessContext>
+    void process(const ProcessContext& context) noexcept
+    {
+        const auto& inputBlock = context.getInputBlock();
+        auto& outputBlock = context.getOutputBlock();
+        const auto numInChannels = inputBlock.getNumChannels();
+        const auto numOutChannels = outputBlock.getNumChannels();
+        const auto numSamples = (int) outputBlock.getNumSamples();
+
+        jassert(inputBlock.getNumSamples() == outputBlock.getNumSamples());
+        outputBlock.copyFrom(inputBlock);
+
+        if (context.isBypassed)
+            return;
+
+        if (numInChannels == 1 && numOutChannels == 1)
+            processMono(outputBlock.getChannelPointer(0), numSamples);
+        else if (numInChannels == 2 && numOutChannels == 2)
+            processStereo(outputBlock.getChannelPointer(0), outputBlock.getChannelPointer(1), numSamples);
+        else
+            jassertfalse; // invalid channel configuration
+    }
+
+private:
+    //==============================================================================
+    static constexpr int chunkSize = 64;
+
+    void processStereo(float* left, float* right, int numSamples) noexcept
+    {
+        float input[chunkSize], damp[chunkSize], feedbck[chunkSize], outL[chunkSize], outR[chunkSize];
+        float wet1[chunkSize], wet2[chunkSize];
+
+        for (int start = 0; start < numSamples; start += chunkSize)
+        {
+            const int num = juce::jmin(chunkSize, numSamples - start);
+            auto* l = left + start;
+            auto* r = right + start;
+
+            juce::FloatVectorOperations::add(input, l, r, num);
+            juce::FloatVectorOperations::multiply(input, gain, num);
+
+            fillSmoothed(damping, damp, num);
+            fillSmoothed(feedback, feedbck, num);
+
+            channels[0].process(input, outL, damp, feedbck, num);
+            channels[1].process(input, outR, damp, feedbck, num);
+
+            fillSmoothed(wetGain1, wet1, num);
+            fillSmoothed(wetGain2, wet2, num);
+
+            for (int i = 0; i < num; ++i)
+            {
+                l[i] = outL[i] * wet1[i] + outR[i] * wet2[i];
+                r[i] = outR[i] * wet1[i] + outL[i] * wet2[i];
+            }
+        }
+    }
+
+    void processMono(float* samples, int numSamples) noexcept
+    {
+        float input[chunkSize], damp[chunkSize], feedbck[chunkSize], output[chunkSize];
+        float wet1[chunkSize];
+
+        for (int start = 0; start < numSamples; start += chunkSize)
+        {
+            const int num = juce::jmin(chunkSize, numSamples - start);
+            auto* s = samples + start;
+
+            juce::FloatVectorOperations::multiply(input, s, gain, num);
+
+            fillSmoothed(damping, damp, num);
+            fillSmoothed(feedback, feedbck, num);
+
+            channels[0].process(input, output, damp, feedbck, num);
+
+            fillSmoothed(wetGain1, wet1, num);
+            juce::FloatVectorOperations::multiply(s, output, wet1, num);
+        }
+    }
+
+    static void fillSmoothed(juce::SmoothedValue<float>& value, float* dest, int num) noexcept
+    {
+        if (! value.isSmoothing())
+        {
+            juce::FloatVectorOperations::fill(dest, value.getTargetValue(), num);
+            return;
+        }
+
+        for (int i = 0; i < num; ++i)
+            dest[i] = value.getNextValue();
+    }
+
+    void updateDecay() noexcept
+    {
+        const bool frozen = parameters.freezeMode >= 0.5f;
+        gain = frozen ? 0.0f : inputGain;
+
+        if (frozen)
+        {
+            damping.setTargetValue(0.0f);
+            feedback.setTargetValue(1.0f);
+            return;
+        }
+
+        // Same size -> feedback mapping as Freeverb, rescaled so one pass around the
+        // (much longer) velvet loop decays by as much as Freeverb's average comb would
+        // over the same time. That keeps the size knob's RT60 comparable.
+        const float combFeedback = parameters.roomSize * 0.28f + 0.7f;
+        const float loopToCombRatio = (float) (segmentSeconds / referenceCombSeconds);
+
+        damping.setTargetValue(parameters.damping * 0.4f);
+        feedback.setTargetValue(std::pow(combFeedback, loopToCombRatio));
+    }
+
+    //==============================================================================
+    class AllPassFilter
+    {
+    public:
+        void setSize(int size)
+        {
+            jassert(size >= chunkSize);
+            buffer.assign((size_t) size, 0.0f);
+            bufferIndex = 0;
+        }
+
+        void clear() noexcept
+        {
+            std::fill(buffer.begin(), buffer.end(), 0.0f);
+        }
+
+        void addMemoryUsage(MemoryUsage& usage) const noexcept
+        {
+            usage.delayLines += MemoryUsage::bytesOf(buffer);
+        }
+
+        /** Processes a chunk in place. The chunk is never longer than the delay, so
+            no sample written here is read back within the same call.
+        */
+        void process(float* samples, int numSamples) noexcept
+        {
+            const int size = (int) buffer.size();
+            const int firstRun = juce::jmin(numSamples, size - bufferIndex);
+
+            processRun(samples, buffer.data() + bufferIndex, firstRun);
+            processRun(samples + firstRun, buffer.data(), numSamples - firstRun);
+
+            bufferIndex = (bufferIndex + numSamples) % size;
+        }
+
+    private:
+        static void processRun(float* samples, float* delayed, int num) noexcept
+        {
+            // A true unity-gain allpass: Freeverb's variant has up to +2.5 dB of gain,
+            // which is harmless after its combs but not inside a feedback loop.
+            float temp[chunkSize];
+
+            juce::FloatVectorOperations::copy(temp, samples, num);
+            juce::FloatVectorOperations::addWithMultiply(temp, delayed, 0.5f, num);
+
+            juce::FloatVectorOperations::copy(samples, delayed, num);
+            juce::FloatVectorOperations::addWithMultiply(samples, temp, -0.5f, num);
+
+            juce::FloatVectorOperations::copy(delayed, temp, num);
+        }
+
+        std::vector<float> buffer;
+        int bufferIndex = 0;
+    };
+
+    //==============================================================================
+    static constexpr int numPulses = 16;
+
+    class Channel
+    {
+    public:
+        void prepare(double sampleRate, int spread, juce::Random& random)
+        {
+            const auto scale = juce::jmax(1.0, sampleRate / 44100.0);
+
+            diffuser[0].setSize(juce::roundToInt((341 + spread) * scale));
+            diffuser[1].setSize(juce::roundToInt((225 + spread) * scale));
+
+            loopLength = juce::roundToInt((segmentSeconds * 44100.0 + spread) * sampleRate / 44100.0);
+            buffer.assign((size_t) juce::nextPowerOfTwo(loopLength + chunkSize), 0.0f);
+            mask = (int) buffer.size() - 1;
+            writeIndex = 0;
+            last = 0.0f;
+
+            // Velvet noise: exactly one pulse per grid interval, at a random offset
+            // within it and with a random sign. Positive pulses are stored first so
+            // the tap sum is two runs of plain additions.
+            const double gridSize = (double) loopLength / numPulses;
+            std::array<int, numPulses> positive{}, negative{};
+            int numNegative = 0;
+            numPositive = 0;
+
+            for (int k = 0; k < numPulses; ++k)
+            {
+                const auto offset = juce::jlimit(0, loopLength - 1,
+                                                 (int) (k * gridSize + random.nextDouble() * (gridSize - 1.0)));
+
+                if (random.nextBool())
+                    positive[(size_t) numPositive++] = offset;
+                else
+                    negative[(size_t) numNegative++] = offset;
+            }
+
+            std::copy(positive.begin(), positive.begin() + numPositive, pulseOffsets.begin());
+            std::copy(negative.begin(), negative.begin() + numNegative, pulseOffsets.begin() + numPositive);
+        }
+
+        void clear() noexcept
+        {
+            std::fill(buffer.begin(), buffer.end(), 0.0f);
+            for (auto& allPass : diffuser)
+                allPass.clear();
+
+            last = 0.0f;
+        }
+
+        void addMemoryUsage(MemoryUsage& usage) const noexcept
+        {
+            usage.delayLines += MemoryUsage::bytesOf(buffer);
+
+            for (const auto& allPass : diffuser)
+                allPass.addMemoryUsage(usage);
+        }
+
+        void process(const float* input, float* output, const float* damp, const float* feedbackLevel, int numSamples) noexcept
+        {
+            jassert(numSamples <= chunkSize);
+            float loopInput[chunkSize];
+
+            // The damped recirculation is the only truly serial part.
+            for (int i = 0; i < numSamples; ++i)
+            {
+                const float recirculated = buffer[(size_t) ((writeIndex - loopLength + i) & mask)];
+                last = recirculated * (1.0f - damp[i]) + last * damp[i];
+                loopInput[i] = input[i] + last * feedbackLevel[i];
+            }
+
+            diffuser[0].process(loopInput, numSamples);
+            diffuser[1].process(loopInput, numSamples);
+
+            const int firstRun = juce::jmin(numSamples, (int) buffer.size() - writeIndex);
+            std::copy(loopInput, loopInput + firstRun, buffer.begin() + writeIndex);
+            std::copy(loopInput + firstRun, loopInput + numSamples, buffer.begin());
+
+            juce::FloatVectorOperations::clear(output, numSamples);
+
+            for (int k = 0; k < numPositive; ++k)
+                accumulateTap(output, pulseOffsets[(size_t) k], numSamples, false);
+
+            for (int k = numPositive; k < numPulses; ++k)
+                accumulateTap(output, pulseOffsets[(size_t) k], numSamples, true);
+
+            writeIndex = (writeIndex + numSamples) & mask;
+        }
+
+    private:
+        void accumulateTap(float* output, int offset, int numSamples, bool negative) noexcept
+        {
+            const int readIndex = (writeIndex - offset) & mask;
+            const int firstRun = juce::jmin(numSamples, (int) buffer.size() - readIndex);
+
+            if (negative)
+            {
+                juce::FloatVectorOperations::subtract(output, buffer.data() + readIndex, firstRun);
+                juce::FloatVectorOperations::subtract(output + firstRun, buffer.data(), numSamples - firstRun);
+            }
+            else
+            {
+                juce::FloatVectorOperations::add(output, buffer.data() + readIndex, firstRun);
+                juce::FloatVectorOperations::add(output + firstRun, buffer.data(), numSamples - firstRun);
+            }
+        }
+
+        std::vector<float> buffer;
+        int mask = 0, writeIndex = 0, loopLength = 0;
+        float last = 0.0f;
+
+        std::array<int, numPulses> pulseOffsets{};
+        int numPositive = 0;
+
+        AllPassFilter diffuser[2];
+    };
+
+    //==============================================================================
+    static constexpr int numChannels = 2;
+    static constexpr int stereoSpread = 23;
+    static constexpr int pulseSeed = 0x7e71;
+    static constexpr double segmentSeconds = 0.06;
+    static constexpr double referenceCombSeconds = 1378.0 / 44100.0; // mean Freeverb comb length
+    static constexpr float inputGain = 0.065f;
+
+    Parameters parameters;
+    float gain = inputGain;
+
+    Channel channels[numChannels];
+
+    juce::SmoothedValue<float> damping, feedback, wetGain1, wetGain2;
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR(VelvetReverb)
+};